@@ -7,8 +7,12 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <learnopengl/asset_pack.h>
 
 std::string readFileContents(std::string path) {
+    std::string text;
+    if (AssetPack::ReadText(path, text))
+        return text;
     std::ifstream in(path);
     std::stringstream buffer;
     buffer << in.rdbuf();
@@ -16,6 +20,8 @@ std::string readFileContents(std::string path) {
 }
 
 void appendShaderFolderIfNotPresent(std::string& path) {
+    if (AssetPack::Contains(path, AssetPack::RAW))
+        return;
     std::ifstream file(path);
     if (!file) {
         path = "resources/shaders/" + path;
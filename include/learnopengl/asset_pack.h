@@ -0,0 +1,319 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/mapped_file.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// one file holding every asset the asset cooker (tools/asset_cooker.cpp) found under resources/.
+// After Mount the file is mapped once and every lookup hands out a pointer into the mapping, so loading an
+// asset is a binary search in the table of contents instead of an open/read/close of its own file.
+// Entries are keyed by their path relative to the project root ("resources/textures/floor.jpeg"), paths
+// built with FileSystem::getPath find the same entry. Anything that is not in the pack (or no pack at all)
+// is read from the loose files as before. A mounted pack never touches the loose files it covers, rerun the
+// cooker after editing one. While working on the assets, Mount with checkSources instead: Find then hashes the
+// loose file on the first lookup of an entry and skips the entry when it changed since it was cooked. MESH
+// entries hold MeshCache::SourceHash, which covers the material libraries too, Model checks those itself.
+//
+// Layout: Header, the 16 byte aligned data of every entry, the table of contents sorted by path hash and
+// the path strings the entries point into.
+class AssetPack
+{
+public:
+    enum Kind : uint32_t {
+        // stored as it is, e.g. shader sources
+        RAW = 0,
+        // CookedTexture
+        TEXTURE = 1,
+        // MeshCache file of the model
+        MESH = 2
+    };
+
+    struct Span {
+        const unsigned char *data;
+        size_t size;
+        // hash (MappedFile::hash) of the file the entry was cooked from
+        uint64_t sourceHash;
+    };
+
+    // maps the pack, false when it is missing or not a pack of this version.
+    // checkSources is for development, it reads every loose file an entry was cooked from once.
+    static bool Mount(const std::string &packPath, bool checkSources = false)
+    {
+        State &state = get();
+        Unmount();
+        if (!state.file.Open(packPath))
+            return false;
+        if (!state.validate())
+        {
+            std::cout << "ERROR::ASSET_PACK:: " << packPath << " is not a valid asset pack" << std::endl;
+            Unmount();
+            return false;
+        }
+        if (checkSources)
+            state.freshness.reset(new std::atomic<unsigned char>[state.entryCount]());
+        return true;
+    }
+
+    static void Unmount()
+    {
+        State &state = get();
+        state.entries = nullptr;
+        state.entryCount = 0;
+        state.freshness.reset();
+        state.file.Close();
+    }
+
+    static bool IsMounted()
+    {
+        return get().entries != nullptr;
+    }
+
+    // whether entries are checked against their loose files, see Mount
+    static bool ChecksSources()
+    {
+        return get().freshness != nullptr;
+    }
+
+    // the entry cooked from path as the given kind, the span stays valid until the pack is unmounted
+    static bool Find(const std::string &path, Kind kind, Span &span)
+    {
+        State &state = get();
+        if (!state.entries)
+            return false;
+        std::string key = Normalize(path);
+        uint64_t hash = HashPath(key);
+        const Entry *begin = state.entries, *end = state.entries + state.entryCount;
+        const Entry *entry = std::lower_bound(begin, end, hash, [](const Entry &e, uint64_t h) { return e.pathHash < h; });
+        for (; entry != end && entry->pathHash == hash; entry++)
+        {
+            const char *name = (const char*)state.file.data() + entry->pathOffset;
+            if (entry->kind == kind && entry->pathLength == key.size() && std::memcmp(name, key.data(), key.size()) == 0)
+            {
+                if (kind != MESH && state.freshness && !state.fresh(entry - begin, path, entry->sourceHash))
+                    return false;
+                span = Span{state.file.data() + entry->offset, (size_t)entry->size, entry->sourceHash};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool Contains(const std::string &path, Kind kind)
+    {
+        Span span;
+        return Find(path, kind, span);
+    }
+
+    // copies a RAW entry into text, false when the pack doesn't have it
+    static bool ReadText(const std::string &path, std::string &text)
+    {
+        Span span;
+        if (!Find(path, RAW, span))
+            return false;
+        text.assign((const char*)span.data, span.size);
+        return true;
+    }
+
+    // the key a path is stored under: forward slashes, no "./" and relative to the project root
+    static std::string Normalize(const std::string &path)
+    {
+        std::string key = path;
+        std::replace(key.begin(), key.end(), '\\', '/');
+        std::string root = FileSystem::getPath("");
+        if (root.size() > 1 && key.compare(0, root.size(), root) == 0)
+            key.erase(0, root.size());
+        while (key.compare(0, 2, "./") == 0)
+            key.erase(0, 2);
+        // directory + '/' + file may double the separator
+        for (size_t i = key.find("//"); i != std::string::npos; i = key.find("//", i))
+            key.erase(i, 1);
+        return key;
+    }
+
+    static uint64_t HashPath(const std::string &key)
+    {
+        uint64_t h = 14695981039346656037ull;
+        for (char c: key)
+        {
+            h ^= (unsigned char)c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    // builds a pack, used by the asset cooker
+    class Writer
+    {
+    public:
+        void Add(const std::string &path, Kind kind, uint64_t sourceHash, const void *data, size_t size)
+        {
+            Pending pending;
+            pending.path = Normalize(path);
+            pending.kind = kind;
+            pending.sourceHash = sourceHash;
+            pending.data.assign((const unsigned char*)data, (const unsigned char*)data + size);
+            pendingEntries.push_back(pending);
+        }
+
+        size_t EntryCount() const
+        {
+            return pendingEntries.size();
+        }
+
+        bool Save(const std::string &packPath) const
+        {
+            std::vector<unsigned char> blob(sizeof(Header), 0);
+            std::vector<Entry> entries;
+            std::string strings;
+            for (const Pending &pending: pendingEntries)
+            {
+                blob.resize((blob.size() + 15) & ~size_t(15), 0);
+                Entry entry;
+                entry.pathHash = HashPath(pending.path);
+                entry.sourceHash = pending.sourceHash;
+                entry.offset = blob.size();
+                entry.size = pending.data.size();
+                entry.kind = pending.kind;
+                entry.pathOffset = strings.size();
+                entry.pathLength = pending.path.size();
+                entry.reserved = 0;
+                blob.insert(blob.end(), pending.data.begin(), pending.data.end());
+                entries.push_back(entry);
+                strings += pending.path;
+            }
+            std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.pathHash < b.pathHash; });
+
+            blob.resize((blob.size() + 15) & ~size_t(15), 0);
+            Header header;
+            header.magic = MAGIC;
+            header.version = VERSION;
+            header.entryCount = entries.size();
+            header.reserved = 0;
+            header.tocOffset = blob.size();
+            header.stringsOffset = header.tocOffset + entries.size() * sizeof(Entry);
+            for (Entry &entry: entries)
+                entry.pathOffset += header.stringsOffset;
+            blob.insert(blob.end(), (const unsigned char*)entries.data(), (const unsigned char*)(entries.data() + entries.size()));
+            blob.insert(blob.end(), strings.begin(), strings.end());
+            std::memcpy(blob.data(), &header, sizeof(header));
+
+            // written under another name first so a running game never maps a half written pack
+            std::string temporaryPath = packPath + ".tmp";
+            {
+                std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+                if (!out || !out.write((const char*)blob.data(), blob.size()))
+                {
+                    std::cout << "ERROR::ASSET_PACK:: could not write " << temporaryPath << std::endl;
+                    return false;
+                }
+            }
+            if (std::rename(temporaryPath.c_str(), packPath.c_str()) != 0)
+            {
+                std::remove(temporaryPath.c_str());
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        struct Pending {
+            std::string path;
+            Kind kind;
+            uint64_t sourceHash;
+            std::vector<unsigned char> data;
+        };
+        std::vector<Pending> pendingEntries;
+    };
+
+private:
+    static const uint32_t MAGIC = 0x4b50474c; // "LGPK"
+    static const uint32_t VERSION = 2;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t tocOffset;
+        uint64_t stringsOffset;
+    };
+
+    struct Entry {
+        uint64_t pathHash;
+        uint64_t sourceHash;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t kind;
+        uint32_t pathOffset;
+        uint32_t pathLength;
+        uint32_t reserved;
+    };
+
+    struct State {
+        MappedFile file;
+        const Entry *entries = nullptr;
+        uint32_t entryCount = 0;
+        // per entry, only when mounted with checkSources: 0 not checked yet, 1 matches its loose file (or there
+        // is none), 2 stale. Workers of the texture loader look up entries too, a race only means a file is
+        // hashed twice.
+        std::unique_ptr<std::atomic<unsigned char>[]> freshness;
+
+        // whether entry index may stand in for the loose file at path, hashed on first use only
+        bool fresh(size_t index, const std::string &path, uint64_t sourceHash)
+        {
+            unsigned char verdict = freshness[index];
+            if (verdict == 0)
+            {
+                MappedFile loose;
+                verdict = !loose.Open(path) || loose.hash() == sourceHash ? 1 : 2;
+                if (verdict == 2 && freshness[index].exchange(verdict) == 0)
+                    std::cout << "ASSET_PACK:: " << path << " changed since the pack was cooked, using the file" << std::endl;
+                freshness[index] = verdict;
+            }
+            return verdict == 1;
+        }
+
+        // checks the header and that every entry lies inside the file
+        bool validate()
+        {
+            size_t total = file.size();
+            if (total < sizeof(Header))
+                return false;
+            const Header *header = (const Header*)file.data();
+            if (header->magic != MAGIC || header->version != VERSION || header->tocOffset % 8 != 0)
+                return false;
+            if (header->tocOffset > total || uint64_t(header->entryCount) * sizeof(Entry) > total - header->tocOffset)
+                return false;
+            const Entry *table = (const Entry*)(file.data() + header->tocOffset);
+            for (uint32_t i = 0; i < header->entryCount; i++)
+            {
+                const Entry &entry = table[i];
+                if (entry.offset > total || entry.size > total - entry.offset ||
+                    entry.pathOffset > total || entry.pathLength > total - entry.pathOffset)
+                    return false;
+            }
+            entries = table;
+            entryCount = header->entryCount;
+            return true;
+        }
+    };
+
+    static State &get()
+    {
+        static State state;
+        return state;
+    }
+};
+
+#endif
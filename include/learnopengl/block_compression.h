@@ -0,0 +1,335 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSION_SSE2 1
+#endif
+
+// S3TC block compression: BC1 (DXT1, RGB at 4 bits per texel) and BC3 (DXT5, RGBA at 8 bits per texel).
+// Every 4x4 block stores two endpoint colors and a 2 bit index per texel into the four colors on the line
+// between them (BC3 adds the same for alpha with 3 bit indices). The endpoints are the inset bounding box
+// of the block along the diagonal that matches its color distribution, and indices come from projecting the
+// texels onto that line, four texels at a time with SSE2 where it is available.
+// Compress is used by the asset cooker, Decompress is the fallback for drivers without S3TC.
+class BlockCompression
+{
+public:
+    enum Format : uint32_t {
+        BC1 = 1,
+        BC3 = 3
+    };
+
+    static unsigned int BlockBytes(Format format)
+    {
+        return format == BC1 ? 8 : 16;
+    }
+
+    static size_t CompressedSize(Format format, unsigned int width, unsigned int height)
+    {
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+    }
+
+    // compresses an image with 3 or 4 channels into out (CompressedSize bytes). Block rows are spread over
+    // threadCount threads, 0 uses one per core.
+    static void Compress(const unsigned char *pixels, unsigned int width, unsigned int height, unsigned int channels,
+                         Format format, unsigned char *out, unsigned int threadCount = 0)
+    {
+        unsigned int blockRows = (height + 3) / 4;
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        threadCount = std::min(threadCount, blockRows);
+        auto compressRows = [=](unsigned int firstRow) {
+            unsigned int blocksPerRow = (width + 3) / 4;
+            alignas(16) unsigned char block[64];
+            for (unsigned int by = firstRow; by < blockRows; by += threadCount)
+                for (unsigned int bx = 0; bx < blocksPerRow; bx++)
+                {
+                    gatherBlock(pixels, width, height, channels, bx, by, block);
+                    unsigned char *target = out + (size_t(by) * blocksPerRow + bx) * BlockBytes(format);
+                    if (format == BC1)
+                        CompressBC1Block(block, target);
+                    else
+                        CompressBC3Block(block, target);
+                }
+        };
+        if (threadCount <= 1)
+        {
+            compressRows(0);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (unsigned int t = 1; t < threadCount; t++)
+            threads.emplace_back(compressRows, t);
+        compressRows(0);
+        for (std::thread &thread: threads)
+            thread.join();
+    }
+
+    // decodes into tightly packed RGBA
+    static void Decompress(const unsigned char *blocks, unsigned int width, unsigned int height, Format format, unsigned char *rgba)
+    {
+        unsigned int blocksPerRow = (width + 3) / 4;
+        unsigned char block[64];
+        for (unsigned int by = 0; by < (height + 3) / 4; by++)
+            for (unsigned int bx = 0; bx < blocksPerRow; bx++)
+            {
+                const unsigned char *source = blocks + (size_t(by) * blocksPerRow + bx) * BlockBytes(format);
+                if (format == BC1)
+                    decodeColorBlock(source, block, false);
+                else
+                {
+                    decodeColorBlock(source + 8, block, true);
+                    decodeAlphaBlock(source, block);
+                }
+                for (unsigned int y = 0; y < 4 && by * 4 + y < height; y++)
+                    for (unsigned int x = 0; x < 4 && bx * 4 + x < width; x++)
+                        std::memcpy(rgba + ((size_t(by) * 4 + y) * width + bx * 4 + x) * 4, block + (y * 4 + x) * 4, 4);
+            }
+    }
+
+    // block is 16 RGBA texels, row by row
+    static void CompressBC1Block(const unsigned char *block, unsigned char *out)
+    {
+        unsigned char low[4], high[4];
+        boundingBox(block, low, high);
+        compressColor(block, low, high, out);
+    }
+
+    static void CompressBC3Block(const unsigned char *block, unsigned char *out)
+    {
+        unsigned char low[4], high[4];
+        boundingBox(block, low, high);
+        compressAlpha(block, low[3], high[3], out);
+        compressColor(block, low, high, out + 8);
+    }
+
+private:
+    // copies a 4x4 block to RGBA, blocks hanging over the edge repeat the last row and column
+    static void gatherBlock(const unsigned char *pixels, unsigned int width, unsigned int height, unsigned int channels,
+                            unsigned int bx, unsigned int by, unsigned char *block)
+    {
+        for (unsigned int y = 0; y < 4; y++)
+        {
+            unsigned int sy = std::min(by * 4 + y, height - 1);
+            for (unsigned int x = 0; x < 4; x++)
+            {
+                unsigned int sx = std::min(bx * 4 + x, width - 1);
+                const unsigned char *texel = pixels + (size_t(sy) * width + sx) * channels;
+                unsigned char *target = block + (y * 4 + x) * 4;
+                target[0] = texel[0];
+                target[1] = texel[1];
+                target[2] = texel[2];
+                target[3] = channels == 4 ? texel[3] : 255;
+            }
+        }
+    }
+
+    static void boundingBox(const unsigned char *block, unsigned char *low, unsigned char *high)
+    {
+#ifdef BLOCK_COMPRESSION_SSE2
+        __m128i p0 = _mm_loadu_si128((const __m128i*)block);
+        __m128i p1 = _mm_loadu_si128((const __m128i*)(block + 16));
+        __m128i p2 = _mm_loadu_si128((const __m128i*)(block + 32));
+        __m128i p3 = _mm_loadu_si128((const __m128i*)(block + 48));
+        __m128i minimum = _mm_min_epu8(_mm_min_epu8(p0, p1), _mm_min_epu8(p2, p3));
+        __m128i maximum = _mm_max_epu8(_mm_max_epu8(p0, p1), _mm_max_epu8(p2, p3));
+        // fold the four texels of each register into one
+        minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+        minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+        maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+        maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+        uint32_t lowBits = _mm_cvtsi128_si32(minimum), highBits = _mm_cvtsi128_si32(maximum);
+        std::memcpy(low, &lowBits, 4);
+        std::memcpy(high, &highBits, 4);
+#else
+        for (unsigned int c = 0; c < 4; c++)
+        {
+            low[c] = 255;
+            high[c] = 0;
+        }
+        for (unsigned int i = 0; i < 16; i++)
+            for (unsigned int c = 0; c < 4; c++)
+            {
+                low[c] = std::min(low[c], block[i * 4 + c]);
+                high[c] = std::max(high[c], block[i * 4 + c]);
+            }
+#endif
+    }
+
+    // steps[i] = round(clamp(dot(texel i - origin, axis) * scale, 0, maxStep))
+    static void project(const unsigned char *block, const float *origin, const float *axis, float scale, float maxStep, int *steps)
+    {
+#ifdef BLOCK_COMPRESSION_SSE2
+        const __m128i mask = _mm_set1_epi32(0xff);
+        const __m128 zero = _mm_setzero_ps(), top = _mm_set1_ps(maxStep), factor = _mm_set1_ps(scale);
+        for (unsigned int group = 0; group < 4; group++)
+        {
+            // four texels, one channel per register
+            __m128i texels = _mm_loadu_si128((const __m128i*)(block + group * 16));
+            __m128 t = zero;
+            for (unsigned int c = 0; c < 4; c++)
+            {
+                if (axis[c] == 0.0f)
+                    continue;
+                __m128 channel = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, c * 8), mask));
+                t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(channel, _mm_set1_ps(origin[c])), _mm_set1_ps(axis[c])));
+            }
+            t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(t, factor), zero), top);
+            _mm_storeu_si128((__m128i*)(steps + group * 4), _mm_cvtps_epi32(t));
+        }
+#else
+        for (unsigned int i = 0; i < 16; i++)
+        {
+            float t = 0.0f;
+            for (unsigned int c = 0; c < 4; c++)
+                t += (block[i * 4 + c] - origin[c]) * axis[c];
+            t = std::min(std::max(t * scale, 0.0f), maxStep);
+            steps[i] = (int)(t + 0.5f);
+        }
+#endif
+    }
+
+    static uint16_t to565(const unsigned char *color)
+    {
+        return uint16_t(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | (color[2] * 31 + 127) / 255);
+    }
+
+    static void from565(uint16_t packed, unsigned char *color)
+    {
+        unsigned int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+        color[3] = 255;
+    }
+
+    static void compressColor(const unsigned char *block, const unsigned char *low, const unsigned char *high, unsigned char *out)
+    {
+        unsigned char start[4], end[4];
+        // move the endpoints inwards a little, the box corners are rarely hit exactly
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            int inset = (high[c] - low[c]) >> 4;
+            start[c] = high[c] - inset;
+            end[c] = low[c] + inset;
+        }
+        // the box diagonal from high to low fits when red and blue grow with green, flip the channels that don't
+        int center[3] = {(low[0] + high[0] + 1) / 2, (low[1] + high[1] + 1) / 2, (low[2] + high[2] + 1) / 2};
+        int covarianceRG = 0, covarianceBG = 0;
+        for (unsigned int i = 0; i < 16; i++)
+        {
+            int g = block[i * 4 + 1] - center[1];
+            covarianceRG += (block[i * 4] - center[0]) * g;
+            covarianceBG += (block[i * 4 + 2] - center[2]) * g;
+        }
+        if (covarianceRG < 0)
+            std::swap(start[0], end[0]);
+        if (covarianceBG < 0)
+            std::swap(start[2], end[2]);
+
+        uint16_t color0 = to565(start), color1 = to565(end);
+        // color0 > color1 selects the four color mode
+        if (color0 < color1)
+            std::swap(color0, color1);
+        uint32_t indices = 0;
+        if (color0 != color1)
+        {
+            unsigned char expanded0[4], expanded1[4];
+            from565(color0, expanded0);
+            from565(color1, expanded1);
+            float origin[4] = {(float)expanded0[0], (float)expanded0[1], (float)expanded0[2], 0.0f};
+            float axis[4] = {(float)expanded1[0] - expanded0[0], (float)expanded1[1] - expanded0[1], (float)expanded1[2] - expanded0[2], 0.0f};
+            float length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+            int steps[16];
+            project(block, origin, axis, 3.0f / length, 3.0f, steps);
+            // steps along the line to the palette order color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1
+            static const uint32_t order[4] = {0, 2, 3, 1};
+            for (unsigned int i = 0; i < 16; i++)
+                indices |= order[steps[i]] << (i * 2);
+        }
+        out[0] = color0 & 0xff;
+        out[1] = color0 >> 8;
+        out[2] = color1 & 0xff;
+        out[3] = color1 >> 8;
+        for (unsigned int i = 0; i < 4; i++)
+            out[4 + i] = (indices >> (i * 8)) & 0xff;
+    }
+
+    static void compressAlpha(const unsigned char *block, unsigned char low, unsigned char high, unsigned char *out)
+    {
+        // alpha0 > alpha1 selects six interpolated values between them
+        out[0] = high;
+        out[1] = low;
+        uint64_t indices = 0;
+        if (high != low)
+        {
+            float origin[4] = {0.0f, 0.0f, 0.0f, (float)high};
+            float axis[4] = {0.0f, 0.0f, 0.0f, -1.0f};
+            int steps[16];
+            project(block, origin, axis, 7.0f / (high - low), 7.0f, steps);
+            // steps from high to low to the palette order alpha0, alpha1, then the interpolated ones
+            static const uint64_t order[8] = {0, 2, 3, 4, 5, 6, 7, 1};
+            for (unsigned int i = 0; i < 16; i++)
+                indices |= order[steps[i]] << (i * 3);
+        }
+        for (unsigned int i = 0; i < 6; i++)
+            out[2 + i] = (indices >> (i * 8)) & 0xff;
+    }
+
+    // BC3 color blocks always use four colors
+    static void decodeColorBlock(const unsigned char *source, unsigned char *block, bool fourColors)
+    {
+        uint16_t color0 = source[0] | source[1] << 8, color1 = source[2] | source[3] << 8;
+        unsigned char palette[4][4];
+        from565(color0, palette[0]);
+        from565(color1, palette[1]);
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            if (fourColors || color0 > color1)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            }
+            else
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        palette[2][3] = 255;
+        palette[3][3] = fourColors || color0 > color1 ? 255 : 0;
+        uint32_t indices = source[4] | source[5] << 8 | source[6] << 16 | uint32_t(source[7]) << 24;
+        for (unsigned int i = 0; i < 16; i++)
+            std::memcpy(block + i * 4, palette[(indices >> (i * 2)) & 3], 4);
+    }
+
+    static void decodeAlphaBlock(const unsigned char *source, unsigned char *block)
+    {
+        unsigned int alpha[8] = {source[0], source[1]};
+        if (alpha[0] > alpha[1])
+            for (unsigned int i = 1; i < 7; i++)
+                alpha[i + 1] = ((7 - i) * alpha[0] + i * alpha[1] + 3) / 7;
+        else
+        {
+            for (unsigned int i = 1; i < 5; i++)
+                alpha[i + 1] = ((5 - i) * alpha[0] + i * alpha[1] + 2) / 5;
+            alpha[6] = 0;
+            alpha[7] = 255;
+        }
+        uint64_t indices = 0;
+        for (unsigned int i = 0; i < 6; i++)
+            indices |= uint64_t(source[2 + i]) << (i * 8);
+        for (unsigned int i = 0; i < 16; i++)
+            block[i * 4 + 3] = alpha[(indices >> (i * 3)) & 7];
+    }
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+
+// axis aligned bounding box, starts out empty so the first point expands it to a single point
+struct AABB {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool isEmpty() const
+    {
+        return min.x > max.x;
+    }
+
+    glm::vec3 center() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 extents() const
+    {
+        return (max - min) * 0.5f;
+    }
+
+    void expand(const glm::vec3 &point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const AABB &other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    // box of the eight transformed corners, computed with the absolute matrix trick (Arvo)
+    AABB transformed(const glm::mat4 &matrix) const
+    {
+        glm::vec3 c = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+        glm::vec3 e = extents();
+        glm::vec3 worldExtents = glm::abs(glm::vec3(matrix[0])) * e.x
+                               + glm::abs(glm::vec3(matrix[1])) * e.y
+                               + glm::abs(glm::vec3(matrix[2])) * e.z;
+        AABB result;
+        result.min = c - worldExtents;
+        result.max = c + worldExtents;
+        return result;
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // the sphere after the model matrix was applied, non uniform scale grows it by the largest axis
+    BoundingSphere transformed(const glm::mat4 &matrix) const
+    {
+        float scale = glm::max(glm::length(glm::vec3(matrix[0])),
+                      glm::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
+        BoundingSphere result;
+        result.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+        result.radius = radius * scale;
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/frustum.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+// bounding volume hierarchy over the world space boxes of scene instances.
+// Nodes are stored depth first, so the left child of a node is the next node and every
+// subtree covers one contiguous range of primitives; a subtree that is completely inside the
+// frustum is therefore accepted without visiting its children, and the boxes of a small subtree that
+// is only partly inside are tested together by an InstanceCuller, four or eight at a time.
+class InstanceBVH
+{
+public:
+    struct Node {
+        AABB bounds;
+        unsigned int firstPrimitive;
+        unsigned int primitiveCount;
+        // index of the right child, 0 for leaves (the root can never be a right child)
+        unsigned int rightChild;
+        unsigned int parent;
+    };
+
+    static const unsigned int MAX_LEAF_SIZE = 4;
+    // subtrees with at most this many primitives are culled per box instead of being descended
+    static const unsigned int CULL_RANGE_SIZE = 16;
+
+    // builds the tree from scratch, instance i is identified by its index in boxes
+    void Build(const std::vector<AABB> &boxes)
+    {
+        primitiveBounds = boxes;
+        primitives.resize(boxes.size());
+        for (unsigned int i = 0; i < primitives.size(); i++)
+            primitives[i] = i;
+        leafOfPrimitive.assign(boxes.size(), 0);
+        slotOfPrimitive.assign(boxes.size(), 0);
+        culler.Resize(boxes.size());
+        nodes.clear();
+        if (boxes.empty())
+            return;
+        nodes.reserve(2 * boxes.size() / MAX_LEAF_SIZE + 1);
+        buildNode(0, boxes.size(), 0);
+        // the culler holds the boxes in the order of primitives, so every subtree is one range of it
+        for (unsigned int slot = 0; slot < primitives.size(); slot++)
+        {
+            slotOfPrimitive[primitives[slot]] = slot;
+            culler.SetBox(slot, boxes[primitives[slot]]);
+        }
+    }
+
+    // moves one instance and refits the boxes on the path to the root.
+    // The topology is kept, so after large movements Build should be called again.
+    void Refit(unsigned int instance, const AABB &box)
+    {
+        primitiveBounds[instance] = box;
+        culler.SetBox(slotOfPrimitive[instance], box);
+        unsigned int nodeIndex = leafOfPrimitive[instance];
+        while (true)
+        {
+            Node &node = nodes[nodeIndex];
+            AABB refitted;
+            if (node.rightChild == 0)
+            {
+                for (unsigned int i = 0; i < node.primitiveCount; i++)
+                    refitted.expand(primitiveBounds[primitives[node.firstPrimitive + i]]);
+            }
+            else
+            {
+                refitted = nodes[nodeIndex + 1].bounds;
+                refitted.expand(nodes[node.rightChild].bounds);
+            }
+            // nothing above changes once a box stays the same
+            if (refitted.min == node.bounds.min && refitted.max == node.bounds.max)
+                break;
+            node.bounds = refitted;
+            if (nodeIndex == 0)
+                break;
+            nodeIndex = node.parent;
+        }
+    }
+
+    // collects the instances whose box touches the frustum.
+    // Planes that a node is completely in front of are not tested again for its children.
+    void Cull(const Frustum &frustum, std::vector<unsigned int> &visible) const
+    {
+        visible.clear();
+        if (nodes.empty())
+            return;
+        stack.clear();
+        stack.push_back(StackEntry{0, InstanceCuller::ALL_PLANES});
+        while (!stack.empty())
+        {
+            StackEntry entry = stack.back();
+            stack.pop_back();
+            const Node &node = nodes[entry.node];
+
+            unsigned int planeMask = entry.planeMask;
+            glm::vec3 c = node.bounds.center();
+            glm::vec3 e = node.bounds.extents();
+            bool outside = false;
+            for (unsigned int p = 0; p < 6 && !outside; p++)
+            {
+                if (!(planeMask & (1u << p)))
+                    continue;
+                const glm::vec4 &plane = frustum.planes[p];
+                float distance = glm::dot(glm::vec3(plane), c) + plane.w;
+                float radius = glm::dot(glm::abs(glm::vec3(plane)), e);
+                if (distance < -radius)
+                    outside = true;
+                else if (distance >= radius)
+                    planeMask &= ~(1u << p);
+            }
+            if (outside)
+                continue;
+
+            if (planeMask == 0)
+            {
+                // whole subtree inside
+                visible.insert(visible.end(), primitives.begin() + node.firstPrimitive,
+                               primitives.begin() + node.firstPrimitive + node.primitiveCount);
+                continue;
+            }
+            if (node.rightChild == 0 || node.primitiveCount <= CULL_RANGE_SIZE)
+            {
+                // a leaf or a small subtree, its boxes are tested against the planes it still crosses
+                culler.Cull(frustum, node.firstPrimitive, node.primitiveCount, planeMask, primitives.data(), visible);
+                continue;
+            }
+            stack.push_back(StackEntry{node.rightChild, planeMask});
+            stack.push_back(StackEntry{entry.node + 1, planeMask});
+        }
+    }
+
+    // collects the instances whose box overlaps the given box
+    void QueryRange(const AABB &range, std::vector<unsigned int> &result) const
+    {
+        result.clear();
+        if (nodes.empty())
+            return;
+        stack.clear();
+        stack.push_back(StackEntry{0, 0});
+        while (!stack.empty())
+        {
+            unsigned int nodeIndex = stack.back().node;
+            stack.pop_back();
+            const Node &node = nodes[nodeIndex];
+            if (!overlaps(node.bounds, range))
+                continue;
+            if (node.rightChild == 0)
+            {
+                for (unsigned int i = 0; i < node.primitiveCount; i++)
+                {
+                    unsigned int instance = primitives[node.firstPrimitive + i];
+                    if (overlaps(primitiveBounds[instance], range))
+                        result.push_back(instance);
+                }
+                continue;
+            }
+            stack.push_back(StackEntry{node.rightChild, 0});
+            stack.push_back(StackEntry{nodeIndex + 1, 0});
+        }
+    }
+
+    // finds the closest instance box hit by the ray within maxDistance, direction does not have to be normalized.
+    // Returns false when nothing is hit, otherwise instance and distance (in units of direction) are filled in.
+    bool Raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance,
+                 unsigned int &instance, float &distance) const
+    {
+        if (nodes.empty())
+            return false;
+        glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        float closest = maxDistance;
+        bool hit = false;
+        stack.clear();
+        stack.push_back(StackEntry{0, 0});
+        while (!stack.empty())
+        {
+            unsigned int nodeIndex = stack.back().node;
+            stack.pop_back();
+            const Node &node = nodes[nodeIndex];
+            float tNode;
+            if (!intersectRay(node.bounds, origin, inverseDirection, closest, tNode))
+                continue;
+            if (node.rightChild == 0)
+            {
+                for (unsigned int i = 0; i < node.primitiveCount; i++)
+                {
+                    unsigned int candidate = primitives[node.firstPrimitive + i];
+                    float t;
+                    if (intersectRay(primitiveBounds[candidate], origin, inverseDirection, closest, t))
+                    {
+                        closest = t;
+                        instance = candidate;
+                        hit = true;
+                    }
+                }
+                continue;
+            }
+            // visit the nearer child first so the farther one is more likely to be rejected
+            unsigned int nearChild = nodeIndex + 1;
+            unsigned int farChild = node.rightChild;
+            float tNear, tFar;
+            bool hitNear = intersectRay(nodes[nearChild].bounds, origin, inverseDirection, closest, tNear);
+            bool hitFar = intersectRay(nodes[farChild].bounds, origin, inverseDirection, closest, tFar);
+            if (hitNear && hitFar)
+            {
+                if (tFar < tNear)
+                    std::swap(nearChild, farChild);
+                stack.push_back(StackEntry{farChild, 0});
+                stack.push_back(StackEntry{nearChild, 0});
+            }
+            else if (hitNear)
+                stack.push_back(StackEntry{nearChild, 0});
+            else if (hitFar)
+                stack.push_back(StackEntry{farChild, 0});
+        }
+        if (hit)
+            distance = closest;
+        return hit;
+    }
+
+    const AABB &bounds(unsigned int instance) const
+    {
+        return primitiveBounds[instance];
+    }
+
+    unsigned int size() const
+    {
+        return primitiveBounds.size();
+    }
+
+private:
+    struct StackEntry {
+        unsigned int node;
+        unsigned int planeMask;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<AABB> primitiveBounds;
+    // instance indices ordered so that every node owns a contiguous range
+    std::vector<unsigned int> primitives;
+    std::vector<unsigned int> leafOfPrimitive;
+    // position of every instance in primitives
+    std::vector<unsigned int> slotOfPrimitive;
+    // the boxes in the order of primitives
+    InstanceCuller culler;
+    // traversal stack, kept around so queries do not allocate
+    mutable std::vector<StackEntry> stack;
+
+    // splits [first, first + count) at the median of the widest centroid axis
+    unsigned int buildNode(unsigned int first, unsigned int count, unsigned int parent)
+    {
+        unsigned int nodeIndex = nodes.size();
+        nodes.push_back(Node());
+        Node node;
+        node.firstPrimitive = first;
+        node.primitiveCount = count;
+        node.rightChild = 0;
+        node.parent = parent;
+        AABB centroids;
+        for (unsigned int i = first; i < first + count; i++)
+        {
+            node.bounds.expand(primitiveBounds[primitives[i]]);
+            centroids.expand(primitiveBounds[primitives[i]].center());
+        }
+
+        glm::vec3 size = centroids.max - centroids.min;
+        if (count <= MAX_LEAF_SIZE || glm::max(size.x, glm::max(size.y, size.z)) <= 0.0f)
+        {
+            for (unsigned int i = first; i < first + count; i++)
+                leafOfPrimitive[primitives[i]] = nodeIndex;
+            nodes[nodeIndex] = node;
+            return nodeIndex;
+        }
+
+        int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+        unsigned int half = count / 2;
+        const std::vector<AABB> &boxes = primitiveBounds;
+        std::nth_element(primitives.begin() + first, primitives.begin() + first + half, primitives.begin() + first + count,
+                         [&boxes, axis](unsigned int a, unsigned int b) {
+                             return boxes[a].min[axis] + boxes[a].max[axis] < boxes[b].min[axis] + boxes[b].max[axis];
+                         });
+        buildNode(first, half, nodeIndex);
+        node.rightChild = buildNode(first + half, count - half, nodeIndex);
+        nodes[nodeIndex] = node;
+        return nodeIndex;
+    }
+
+    static bool overlaps(const AABB &a, const AABB &b)
+    {
+        return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+               a.min.y <= b.max.y && a.max.y >= b.min.y &&
+               a.min.z <= b.max.z && a.max.z >= b.min.z;
+    }
+
+    // slab test, tEntry is clamped to 0 when the origin is inside the box
+    static bool intersectRay(const AABB &box, const glm::vec3 &origin, const glm::vec3 &inverseDirection,
+                             float maxDistance, float &tEntry)
+    {
+        glm::vec3 t0 = (box.min - origin) * inverseDirection;
+        glm::vec3 t1 = (box.max - origin) * inverseDirection;
+        glm::vec3 tMin = glm::min(t0, t1);
+        glm::vec3 tMax = glm::max(t0, t1);
+        float enter = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+        float exit = glm::min(glm::min(tMax.x, tMax.y), glm::min(tMax.z, maxDistance));
+        tEntry = enter;
+        return enter <= exit;
+    }
+};
+
+#endif
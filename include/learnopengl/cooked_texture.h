@@ -0,0 +1,263 @@
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/block_compression.h>
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/mip_generator.h>
+#include <learnopengl/texture_uploader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// EXT_texture_compression_s3tc and EXT_texture_sRGB, not part of the 3.3 loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// an image as the asset cooker stores it in the pack: every mip level, so loading it is one upload per level
+// straight out of the mapped pack, without decoding or glGenerateMipmap.
+// RGB and RGBA images whose sides are multiples of 4 are block compressed (BC1 and BC3, a sixth and a quarter
+// of the uncompressed size in video memory), the rest keeps its pixels as they are.
+// Layout: Header, then the levels from the largest down, each starting at a 16 byte boundary with tightly
+// packed rows (or blocks).
+class CookedTexture
+{
+public:
+    unsigned int width = 0, height = 0;
+    // 1, 3 or 4 like stbi_load with 0 requested components
+    unsigned int channels = 0;
+    unsigned int levels = 0;
+    // BlockCompression::Format, or UNCOMPRESSED
+    unsigned int format = UNCOMPRESSED;
+
+    static const unsigned int UNCOMPRESSED = 0;
+
+    // reads the header of a TEXTURE entry, false when it is broken
+    bool Parse(const AssetPack::Span &span)
+    {
+        if (span.size < sizeof(Header))
+            return false;
+        Header header;
+        std::memcpy(&header, span.data, sizeof(header));
+        if (header.width == 0 || header.height == 0 || header.levels == 0 || header.levels > 32 ||
+            (header.channels != 1 && header.channels != 3 && header.channels != 4) ||
+            (header.format != UNCOMPRESSED && header.format != BlockCompression::BC1 && header.format != BlockCompression::BC3))
+            return false;
+        width = header.width;
+        height = header.height;
+        channels = header.channels;
+        levels = header.levels;
+        format = header.format;
+        data = span.data;
+        if (levelOffset(levels - 1) + LevelSize(levels - 1) > span.size)
+            return false;
+        return true;
+    }
+
+    bool IsCompressed() const
+    {
+        return format != UNCOMPRESSED;
+    }
+
+    const unsigned char *Level(unsigned int level) const
+    {
+        return data + levelOffset(level);
+    }
+
+    unsigned int LevelWidth(unsigned int level) const
+    {
+        return width >> level ? width >> level : 1;
+    }
+
+    unsigned int LevelHeight(unsigned int level) const
+    {
+        return height >> level ? height >> level : 1;
+    }
+
+    // bytes of the level as stored
+    size_t LevelSize(unsigned int level) const
+    {
+        if (IsCompressed())
+            return BlockCompression::CompressedSize(BlockCompression::Format(format), LevelWidth(level), LevelHeight(level));
+        return size_t(LevelWidth(level)) * LevelHeight(level) * channels;
+    }
+
+    // the level as tightly packed RGBA, whatever it is stored as
+    void DecodeLevel(unsigned int level, std::vector<unsigned char> &rgba) const
+    {
+        unsigned int w = LevelWidth(level), h = LevelHeight(level);
+        rgba.resize(size_t(w) * h * 4);
+        if (IsCompressed())
+        {
+            BlockCompression::Decompress(Level(level), w, h, BlockCompression::Format(format), rgba.data());
+            return;
+        }
+        const unsigned char *texel = Level(level);
+        for (size_t i = 0; i < size_t(w) * h; i++, texel += channels)
+        {
+            // grey and RGB expand the way stbi_load does when asked for 4 components
+            rgba[i * 4] = texel[0];
+            rgba[i * 4 + 1] = channels >= 3 ? texel[1] : texel[0];
+            rgba[i * 4 + 2] = channels >= 3 ? texel[2] : texel[0];
+            rgba[i * 4 + 3] = channels == 4 ? texel[3] : 255;
+        }
+    }
+
+    // uploads every level to the GL_TEXTURE_2D that is bound. Compressed levels are decoded first when the
+    // driver can't sample them. With an uploader the levels go through its staging memory; without wait
+    // nothing is done and false returned while that memory is still busy.
+    bool Upload(bool gamma, TextureUploader *uploader = nullptr, bool wait = true) const
+    {
+        GLenum dataFormat = channels == 1 ? GL_RED : channels == 3 ? GL_RGB : GL_RGBA;
+        GLenum internalFormat = dataFormat;
+        if (gamma && channels == 3)
+            internalFormat = GL_SRGB;
+        else if (gamma && channels == 4)
+            internalFormat = GL_SRGB_ALPHA;
+        bool decode = IsCompressed() && !SupportsCompression(gamma);
+
+        // the levels are one block in the pack, they are staged together and keep their offsets
+        const unsigned char *source = Level(0);
+        size_t size = levelOffset(levels - 1) + LevelSize(levels - 1) - levelOffset(0);
+        TextureUploader::Staging staging;
+        bool staged = false;
+        if (uploader && !decode && uploader->Fits(size))
+        {
+            staged = uploader->Map(size, wait, staging);
+            if (!staged && !wait)
+                return false;
+            if (staged)
+            {
+                std::memcpy(staging.data, Level(0), size);
+                uploader->Unmap();
+                source = TextureUploader::Source(staging);
+            }
+        }
+        auto levelSource = [&](unsigned int level) { return source + (levelOffset(level) - levelOffset(0)); };
+
+        // rows are tightly packed
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (decode)
+        {
+            std::vector<unsigned char> rgba;
+            for (unsigned int level = 0; level < levels; level++)
+            {
+                DecodeLevel(level, rgba);
+                glTexImage2D(GL_TEXTURE_2D, level, internalFormat, LevelWidth(level), LevelHeight(level), 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+            }
+        }
+        else if (IsCompressed())
+        {
+            GLenum compressedFormat;
+            if (format == BlockCompression::BC1)
+                compressedFormat = gamma ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            else
+                compressedFormat = gamma ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            for (unsigned int level = 0; level < levels; level++)
+                glCompressedTexImage2D(GL_TEXTURE_2D, level, compressedFormat, LevelWidth(level), LevelHeight(level), 0,
+                                       LevelSize(level), levelSource(level));
+        }
+        else
+        {
+            for (unsigned int level = 0; level < levels; level++)
+                glTexImage2D(GL_TEXTURE_2D, level, internalFormat, LevelWidth(level), LevelHeight(level), 0,
+                             dataFormat, GL_UNSIGNED_BYTE, levelSource(level));
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        if (staged)
+            uploader->Submit();
+        return true;
+    }
+
+    // whether the driver takes S3TC textures (in sRGB too when gamma is set)
+    static bool SupportsCompression(bool gamma)
+    {
+        static const bool s3tc = HasGLExtension("GL_EXT_texture_compression_s3tc");
+        static const bool s3tcSrgb = s3tc && (HasGLExtension("GL_EXT_texture_sRGB") || HasGLExtension("GL_EXT_texture_compression_s3tc_srgb"));
+        return gamma ? s3tcSrgb : s3tc;
+    }
+
+    // the TEXTURE entry for an image, with a full mip chain down to 1x1 (MipGenerator, in linear light for srgb
+    // color). compress picks BC1/BC3 for images that allow it, the encoder runs on every core.
+    static std::vector<unsigned char> Cook(const unsigned char *pixels, unsigned int width, unsigned int height, unsigned int channels,
+                                           bool compress = true, bool srgb = true)
+    {
+        Header header;
+        header.width = width;
+        header.height = height;
+        header.channels = channels;
+        header.levels = MipGenerator::LevelCount(width, height);
+        header.format = UNCOMPRESSED;
+        // the smaller levels may end in partial blocks, the largest one must not
+        if (compress && channels >= 3 && width % 4 == 0 && height % 4 == 0)
+            header.format = channels == 3 ? BlockCompression::BC1 : BlockCompression::BC3;
+        header.reserved = 0;
+
+        std::vector<unsigned char> blob(sizeof(Header));
+        std::memcpy(blob.data(), &header, sizeof(header));
+        std::vector<unsigned char> level(pixels, pixels + width * height * channels);
+        for (unsigned int l = 0; l < header.levels; l++)
+        {
+            blob.resize((blob.size() + 15) & ~size_t(15), 0);
+            if (header.format == UNCOMPRESSED)
+                blob.insert(blob.end(), level.begin(), level.end());
+            else
+            {
+                BlockCompression::Format blockFormat = BlockCompression::Format(header.format);
+                size_t start = blob.size();
+                blob.resize(start + BlockCompression::CompressedSize(blockFormat, width, height));
+                BlockCompression::Compress(level.data(), width, height, channels, blockFormat, &blob[start]);
+            }
+            if (l + 1 < header.levels)
+            {
+                std::vector<unsigned char> next(std::max(1u, width / 2) * std::max(1u, height / 2) * channels);
+                MipGenerator::Downsample(level.data(), width, height, channels, srgb, next.data());
+                width = std::max(1u, width / 2);
+                height = std::max(1u, height / 2);
+                level.swap(next);
+            }
+        }
+        return blob;
+    }
+
+private:
+    struct Header {
+        uint32_t width;
+        uint32_t height;
+        uint32_t channels;
+        uint32_t levels;
+        uint32_t format;
+        uint32_t reserved;
+    };
+
+    const unsigned char *data = nullptr;
+
+    size_t levelOffset(unsigned int level) const
+    {
+        size_t offset = sizeof(Header);
+        for (unsigned int l = 0; l < level; l++)
+        {
+            offset = (offset + 15) & ~size_t(15);
+            offset += LevelSize(l);
+        }
+        return (offset + 15) & ~size_t(15);
+    }
+};
+
+#endif
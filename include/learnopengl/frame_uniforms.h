@@ -0,0 +1,119 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+#include <learnopengl/stream_buffer.h>
+
+#include <cstddef>
+#include <iostream>
+
+// The structs below mirror the FrameData uniform block of the shaders with std140 layout:
+// a vec3 is aligned like a vec4, so every vec3 is followed either by a float that fits
+// into its last four bytes or by an explicit padding member.
+
+struct DirLight {
+    glm::vec3 direction;
+    float pad0;
+
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+struct SpotLight {
+    glm::vec3 position;
+    float pad0;
+    glm::vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+struct FrameData {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPosition;
+    float time;
+    DirLight dirLight;
+    SpotLight spotLight;
+    int spotLightOn;
+    float pad[3];
+};
+
+static_assert(sizeof(DirLight) == 64, "DirLight does not match std140");
+static_assert(offsetof(SpotLight, cutOff) == 28 && offsetof(SpotLight, ambient) == 48 && sizeof(SpotLight) == 96,
+              "SpotLight does not match std140");
+static_assert(offsetof(FrameData, dirLight) == 144 && offsetof(FrameData, spotLight) == 208 &&
+              offsetof(FrameData, spotLightOn) == 304 && sizeof(FrameData) == 320,
+              "FrameData does not match std140");
+
+// uniform buffer holding the FrameData block, uploaded once per frame and bound to a fixed binding point
+class FrameUniforms
+{
+public:
+    static const unsigned int BINDING = 0;
+    unsigned int UBO = 0;
+
+    void Create()
+    {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, UBO);
+    }
+
+    // connects the FrameData block of a program to the buffer, needed once per program
+    void Attach(const Shader &shader)
+    {
+        unsigned int blockIndex = glGetUniformBlockIndex(shader.ID, "FrameData");
+        if (blockIndex == GL_INVALID_INDEX)
+        {
+            std::cout << "ERROR::FRAME_UNIFORMS:: program " << shader.ID << " has no FrameData block" << std::endl;
+            return;
+        }
+        glUniformBlockBinding(shader.ID, blockIndex, BINDING);
+    }
+
+    // with a stream the block is read from this frame's part of it, otherwise UBO is updated in place
+    void Update(const FrameData &data, StreamBuffer *stream = nullptr)
+    {
+        GLintptr offset;
+        if (stream && stream->Write(&data, sizeof(FrameData), offsetAlignment, offset))
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, stream->buffer, offset, sizeof(FrameData));
+            return;
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, UBO);
+    }
+
+    void Delete()
+    {
+        glDeleteBuffers(1, &UBO);
+    }
+
+private:
+    GLint offsetAlignment = 256;
+};
+
+#endif
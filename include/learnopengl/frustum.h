@@ -0,0 +1,212 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define FRUSTUM_SSE
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// the six planes of the view volume, normals point inwards so a point is inside when every distance is positive
+class Frustum
+{
+public:
+    glm::vec4 planes[6];
+
+    Frustum() = default;
+
+    // extracts the planes straight from projection * view (Gribb & Hartmann)
+    explicit Frustum(const glm::mat4 &viewProjection)
+    {
+        glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+        glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+        glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+        glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+        planes[0] = row3 + row0; // left
+        planes[1] = row3 - row0; // right
+        planes[2] = row3 + row1; // bottom
+        planes[3] = row3 - row1; // top
+        planes[4] = row3 + row2; // near
+        planes[5] = row3 - row2; // far
+        for (glm::vec4 &plane: planes)
+            plane /= glm::length(glm::vec3(plane));
+    }
+
+    bool intersects(const BoundingSphere &sphere) const
+    {
+        for (const glm::vec4 &plane: planes)
+            if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+                return false;
+        return true;
+    }
+
+    bool intersects(const AABB &box) const
+    {
+        glm::vec3 c = box.center();
+        glm::vec3 e = box.extents();
+        for (const glm::vec4 &plane: planes)
+        {
+            float r = glm::dot(glm::abs(glm::vec3(plane)), e);
+            if (glm::dot(glm::vec3(plane), c) + plane.w < -r)
+                return false;
+        }
+        return true;
+    }
+};
+
+// keeps the world space boxes of many instances in SoA form (centers and extents) so that four (SSE) or
+// eight (AVX) of them are tested against a plane per iteration. InstanceBVH keeps one in the order of its
+// primitives and hands it the contiguous ranges of its small subtrees.
+class InstanceCuller
+{
+public:
+    static const unsigned int ALL_PLANES = (1u << 6) - 1;
+
+    void Resize(unsigned int amount)
+    {
+        centerX.assign(amount, 0.0f);
+        centerY.assign(amount, 0.0f);
+        centerZ.assign(amount, 0.0f);
+        extentX.assign(amount, 0.0f);
+        extentY.assign(amount, 0.0f);
+        extentZ.assign(amount, 0.0f);
+    }
+
+    void SetBox(unsigned int index, const AABB &box)
+    {
+        glm::vec3 c = box.center();
+        glm::vec3 e = box.extents();
+        centerX[index] = c.x;
+        centerY[index] = c.y;
+        centerZ[index] = c.z;
+        extentX[index] = e.x;
+        extentY[index] = e.y;
+        extentZ[index] = e.z;
+    }
+
+    // appends ids[i] for every box i in [first, first + count) that touches the frustum, in increasing order.
+    // Only the planes in planeMask are tested, the same test as Frustum::intersects(AABB).
+    void Cull(const Frustum &frustum, unsigned int first, unsigned int count, unsigned int planeMask,
+              const unsigned int *ids, std::vector<unsigned int> &visible) const
+    {
+        glm::vec4 planes[6];
+        unsigned int planeCount = 0;
+        for (unsigned int p = 0; p < 6; p++)
+            if (planeMask & (1u << p))
+                planes[planeCount++] = frustum.planes[p];
+        unsigned int i = first, end = first + count;
+#if defined(__AVX__)
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 cx = _mm256_loadu_ps(&centerX[i]);
+            __m256 cy = _mm256_loadu_ps(&centerY[i]);
+            __m256 cz = _mm256_loadu_ps(&centerZ[i]);
+            __m256 ex = _mm256_loadu_ps(&extentX[i]);
+            __m256 ey = _mm256_loadu_ps(&extentY[i]);
+            __m256 ez = _mm256_loadu_ps(&extentZ[i]);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (unsigned int p = 0; p < planeCount; p++)
+            {
+                const glm::vec4 &plane = planes[p];
+                __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)),
+                                                                     _mm256_mul_ps(cy, _mm256_set1_ps(plane.y))),
+                                                       _mm256_mul_ps(cz, _mm256_set1_ps(plane.z))),
+                                         _mm256_set1_ps(plane.w));
+                __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(std::abs(plane.x))),
+                                                       _mm256_mul_ps(ey, _mm256_set1_ps(std::abs(plane.y)))),
+                                         _mm256_mul_ps(ez, _mm256_set1_ps(std::abs(plane.z))));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_sub_ps(_mm256_setzero_ps(), r), _CMP_GE_OQ));
+            }
+            appendVisible(i, (unsigned int)_mm256_movemask_ps(inside), ids, visible);
+        }
+#endif
+#if defined(FRUSTUM_SSE)
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 cx = _mm_loadu_ps(&centerX[i]);
+            __m128 cy = _mm_loadu_ps(&centerY[i]);
+            __m128 cz = _mm_loadu_ps(&centerZ[i]);
+            __m128 ex = _mm_loadu_ps(&extentX[i]);
+            __m128 ey = _mm_loadu_ps(&extentY[i]);
+            __m128 ez = _mm_loadu_ps(&extentZ[i]);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (unsigned int p = 0; p < planeCount; p++)
+            {
+                const glm::vec4 &plane = planes[p];
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)),
+                                                            _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                                                 _mm_mul_ps(cz, _mm_set1_ps(plane.z))),
+                                      _mm_set1_ps(plane.w));
+                __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::abs(plane.x))),
+                                                 _mm_mul_ps(ey, _mm_set1_ps(std::abs(plane.y)))),
+                                      _mm_mul_ps(ez, _mm_set1_ps(std::abs(plane.z))));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_sub_ps(_mm_setzero_ps(), r)));
+            }
+            appendVisible(i, (unsigned int)_mm_movemask_ps(inside), ids, visible);
+        }
+#endif
+        // the rest of the range, and everything on targets without SSE
+        for (; i < end; i++)
+        {
+            bool inside = true;
+            for (unsigned int p = 0; p < planeCount && inside; p++)
+            {
+                const glm::vec4 &plane = planes[p];
+                float d = centerX[i] * plane.x + centerY[i] * plane.y + centerZ[i] * plane.z + plane.w;
+                float r = extentX[i] * std::abs(plane.x) + extentY[i] * std::abs(plane.y) + extentZ[i] * std::abs(plane.z);
+                inside = d >= -r;
+            }
+            if (inside)
+                visible.push_back(ids[i]);
+        }
+    }
+
+    unsigned int size() const
+    {
+        return centerX.size();
+    }
+
+private:
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    static void appendVisible(unsigned int first, unsigned int mask, const unsigned int *ids, std::vector<unsigned int> &visible)
+    {
+        while (mask)
+        {
+            visible.push_back(ids[first + lowestBit(mask)]);
+            mask &= mask - 1;
+        }
+    }
+
+    // index of the lowest set bit, mask is never 0
+    static unsigned int lowestBit(unsigned int mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long bit;
+        _BitScanForward(&bit, mask);
+        return (unsigned int)bit;
+#elif defined(__GNUC__)
+        return (unsigned int)__builtin_ctz(mask);
+#else
+        unsigned int bit = 0;
+        while (!(mask & 1u))
+        {
+            mask >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <stb_image.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// decodes images with stb_image into memory the caller already has, e.g. a mapped pixel buffer.
+// libs/stb_image.cpp routes the allocations of stb_image through Allocate/Reallocate/Free. While DecodeInto runs,
+// the allocation that is as large as the decoded image gets the destination instead of fresh memory,
+// so the pixels land there without an extra buffer and copy. Should stb_image still finish in a buffer of its
+// own (an image it has to convert), the pixels are copied over.
+class ImageDecoder
+{
+public:
+    // size and channel count in the file, read from the header only
+    static bool Info(const std::string &path, int &width, int &height, int &channels)
+    {
+        return stbi_info(path.c_str(), &width, &height, &channels) != 0;
+    }
+
+    // bytes a destination for the image needs, the jpeg decoder asks for one more than the pixels take
+    static size_t Capacity(int width, int height, int channels)
+    {
+        return (size_t)width * height * channels + 1;
+    }
+
+    // decodes path with the given number of channels into destination, false when it can't be decoded or is
+    // larger than capacity
+    static bool DecodeInto(const std::string &path, int channels, unsigned char *destination, size_t capacity,
+                           int &width, int &height)
+    {
+        int fileChannels;
+        if (!Info(path, width, height, fileChannels))
+            return false;
+        Target &current = target();
+        current.destination = destination;
+        current.capacity = capacity;
+        current.imageSize = (size_t)width * height * channels;
+        current.taken = false;
+        unsigned char *pixels = stbi_load(path.c_str(), &width, &height, &fileChannels, channels);
+        current.destination = nullptr;
+        if (!pixels)
+            return false;
+        size_t size = (size_t)width * height * channels;
+        if (pixels == destination)
+            return size <= capacity;
+        bool fits = size <= capacity;
+        if (fits)
+            std::memcpy(destination, pixels, size);
+        stbi_image_free(pixels);
+        return fits;
+    }
+
+    // allocation hooks of stb_image, see libs/stb_image.cpp
+    static void *Allocate(size_t size)
+    {
+        Target &current = target();
+        if (current.destination && !current.taken && size <= current.capacity &&
+            (size == current.imageSize || size == current.imageSize + 1))
+        {
+            current.taken = true;
+            return current.destination;
+        }
+        return std::malloc(size);
+    }
+
+    static void *Reallocate(void *pointer, size_t size)
+    {
+        Target &current = target();
+        if (!pointer || pointer != current.destination)
+            return std::realloc(pointer, size);
+        if (size <= current.capacity)
+            return pointer;
+        // outgrew the destination, continue in memory of its own
+        void *grown = std::malloc(size);
+        if (grown)
+        {
+            std::memcpy(grown, pointer, current.capacity);
+            current.taken = false;
+        }
+        return grown;
+    }
+
+    static void Free(void *pointer)
+    {
+        Target &current = target();
+        if (pointer && pointer == current.destination)
+            current.taken = false;
+        else
+            std::free(pointer);
+    }
+
+private:
+    // the destination of the decode running on this thread
+    struct Target {
+        unsigned char *destination = nullptr;
+        size_t capacity = 0;
+        size_t imageSize = 0;
+        bool taken = false;
+    };
+
+    static Target &target()
+    {
+        static thread_local Target current;
+        return current;
+    }
+};
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/stream_buffer.h>
+
+#include <iostream>
+#include <vector>
+
+// far away instances of a model drawn as camera facing quads.
+// At load time the model is rendered from framesPerSide * framesPerSide directions into an atlas of
+// albedo and model space normals; the directions are spread over the whole sphere with an octahedral
+// mapping, so the frame to show for a view direction is found by encoding that direction.
+// The mapping has to match octEncode/octDecode in impostor.vs.
+class Impostor
+{
+public:
+    unsigned int albedoAtlas = 0;
+    unsigned int normalAtlas = 0;
+    unsigned int framesPerSide = 0;
+    // sphere of the baked model in model space, every frame covers its projection
+    BoundingSphere sphere;
+    // when set, the instance matrices are written into this frame's part of the stream
+    StreamBuffer *instanceStream = nullptr;
+
+    // renders the model into the atlases. bakeShader is expected to be impostor_bake.vs/.fs.
+    void Bake(Model &model, Shader &bakeShader, unsigned int framesPerSide = 8, unsigned int frameSize = 256)
+    {
+        this->framesPerSide = framesPerSide;
+        sphere = model.boundingSphere;
+        unsigned int atlasSize = framesPerSide * frameSize;
+
+        // albedo is stored as sRGB so the dark parts of the forest don't band
+        albedoAtlas = createAtlas(GL_SRGB8_ALPHA8, atlasSize);
+        normalAtlas = createAtlas(GL_RGBA8, atlasSize);
+
+        unsigned int framebuffer, depthBuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoAtlas, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalAtlas, 0);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        unsigned int attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, attachments);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::IMPOSTOR:: Framebuffer is not complete!" << std::endl;
+
+        // remember the state the bake changes
+        int viewport[4];
+        float clearColor[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+
+        glEnable(GL_FRAMEBUFFER_SRGB);
+        glEnable(GL_DEPTH_TEST);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        float r = sphere.radius;
+        glm::mat4 projection = glm::ortho(-r, r, -r, r, 0.0f, 4.0f * r);
+        bakeShader.use();
+        bakeShader.setMat4("projection", projection);
+        for (unsigned int y = 0; y < framesPerSide; y++)
+        {
+            for (unsigned int x = 0; x < framesPerSide; x++)
+            {
+                glm::vec3 direction = octDecode(glm::vec2((x + 0.5f) / framesPerSide, (y + 0.5f) / framesPerSide));
+                glm::mat4 view = glm::lookAt(sphere.center + direction * 2.0f * r, sphere.center, frameUp(direction));
+                bakeShader.setMat4("view", view);
+                glViewport(x * frameSize, y * frameSize, frameSize, frameSize);
+                model.Draw(bakeShader);
+            }
+        }
+
+        glDisable(GL_FRAMEBUFFER_SRGB);
+        glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        glDeleteFramebuffers(1, &framebuffer);
+
+        glBindTexture(GL_TEXTURE_2D, albedoAtlas);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, normalAtlas);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        setupQuad();
+    }
+
+    // uploads the model matrices of the instances drawn as impostors
+    void SetInstanceMatrices(const glm::mat4 *matrices, unsigned int amount)
+    {
+        instanceCount = amount;
+        if (instanceStream && amount > 0 &&
+            instanceStream->Write(matrices, amount * sizeof(glm::mat4), 16, instanceSourceOffset))
+        {
+            instanceSource = instanceStream->buffer;
+            return;
+        }
+        instanceSource = instanceVBO;
+        instanceSourceOffset = 0;
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (amount > instanceCapacity)
+        {
+            glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), matrices, GL_DYNAMIC_DRAW);
+            instanceCapacity = amount;
+        }
+        else if (amount > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, amount * sizeof(glm::mat4), matrices);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // draws all instances with impostor.vs/.fs, view, projection and the lights are set by the caller
+    void Draw(Shader &shader)
+    {
+        if (instanceCount == 0)
+            return;
+        shader.set(shader.getUniform<glm::vec4>(UNIFORM("sphere")), glm::vec4(sphere.center, sphere.radius));
+        shader.set(shader.getUniform<int>(UNIFORM("framesPerSide")), (int)framesPerSide);
+        // the atlases go to the units the shader assigned its samplers, -1 when the compiler dropped one
+        GLint albedoUnit = shader.samplerUnit(UNIFORM("albedoAtlas"));
+        GLint normalUnit = shader.samplerUnit(UNIFORM("normalAtlas"));
+        if (albedoUnit >= 0)
+        {
+            glActiveTexture(GL_TEXTURE0 + albedoUnit);
+            glBindTexture(GL_TEXTURE_2D, albedoAtlas);
+        }
+        if (normalUnit >= 0)
+        {
+            glActiveTexture(GL_TEXTURE0 + normalUnit);
+            glBindTexture(GL_TEXTURE_2D, normalAtlas);
+        }
+
+        glBindVertexArray(quadVAO);
+        if (instanceSource != pointedBuffer || instanceSourceOffset != pointedOffset)
+            setInstanceAttributes(instanceSource, instanceSourceOffset);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instanceCount);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void Delete()
+    {
+        glDeleteTextures(1, &albedoAtlas);
+        glDeleteTextures(1, &normalAtlas);
+        glDeleteVertexArrays(1, &quadVAO);
+        glDeleteBuffers(1, &quadVBO);
+        glDeleteBuffers(1, &instanceVBO);
+    }
+
+    // maps a unit direction to [0, 1]^2, the upper hemisphere fills the inner diamond
+    static glm::vec2 octEncode(glm::vec3 direction)
+    {
+        direction /= glm::abs(direction.x) + glm::abs(direction.y) + glm::abs(direction.z);
+        glm::vec2 p(direction.x, direction.z);
+        if (direction.y < 0.0f)
+            p = glm::vec2((1.0f - glm::abs(p.y)) * signNotZero(p.x), (1.0f - glm::abs(p.x)) * signNotZero(p.y));
+        return p * 0.5f + glm::vec2(0.5f);
+    }
+
+    static glm::vec3 octDecode(glm::vec2 uv)
+    {
+        glm::vec2 e = uv * 2.0f - glm::vec2(1.0f);
+        glm::vec3 direction(e.x, 1.0f - glm::abs(e.x) - glm::abs(e.y), e.y);
+        if (direction.y < 0.0f)
+        {
+            float x = (1.0f - glm::abs(e.y)) * signNotZero(e.x);
+            float z = (1.0f - glm::abs(e.x)) * signNotZero(e.y);
+            direction.x = x;
+            direction.z = z;
+        }
+        return glm::normalize(direction);
+    }
+
+private:
+    unsigned int quadVAO = 0, quadVBO = 0;
+    unsigned int instanceVBO = 0;
+    unsigned int instanceCount = 0;
+    unsigned int instanceCapacity = 0;
+    // where this frame's matrices are and where the attributes of quadVAO point
+    unsigned int instanceSource = 0, pointedBuffer = 0;
+    GLintptr instanceSourceOffset = 0, pointedOffset = 0;
+
+    static float signNotZero(float value)
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    // up vector of the bake camera, impostor.vs builds the quad from the same one
+    static glm::vec3 frameUp(const glm::vec3 &direction)
+    {
+        return glm::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    static unsigned int createAtlas(GLenum internalFormat, unsigned int size)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // deeper mips would mix neighbouring frames
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 4);
+        return texture;
+    }
+
+    void setupQuad()
+    {
+        float corners[] = {
+                -1.0f, -1.0f,
+                 1.0f, -1.0f,
+                -1.0f,  1.0f,
+                 1.0f,  1.0f
+        };
+        glGenVertexArrays(1, &quadVAO);
+        glGenBuffers(1, &quadVBO);
+        glGenBuffers(1, &instanceVBO);
+        glBindVertexArray(quadVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        // same per-instance matrix layout as Mesh::SetInstanceBuffer
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(5 + i);
+            glVertexAttribDivisor(5 + i, 1);
+        }
+        setInstanceAttributes(instanceVBO, 0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // expects quadVAO to be bound
+    void setInstanceAttributes(unsigned int buffer, GLintptr offset)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (unsigned int i = 0; i < 4; i++)
+            glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + i * sizeof(glm::vec4)));
+        pointedBuffer = buffer;
+        pointedOffset = offset;
+    }
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef INDEX_BUFFER_H
+#define INDEX_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// element buffers are stored with 16 bit indices whenever every vertex can be addressed with them, which halves
+// their memory and what the vertex fetch reads. Callers keep unsigned int indices, the narrowing happens on upload
+// and the draw calls take Type and Offset from here.
+class IndexBuffer
+{
+public:
+    // the smallest index type for a buffer of vertexCount vertices
+    static GLenum TypeFor(size_t vertexCount)
+    {
+        return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+
+    static size_t Size(GLenum type)
+    {
+        return type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    }
+
+    // the pointer argument of glDrawElements* for a range starting at firstIndex
+    static const void *Offset(GLenum type, unsigned int firstIndex)
+    {
+        return (const void*)(firstIndex * Size(type));
+    }
+
+    // fills the buffer bound to GL_ELEMENT_ARRAY_BUFFER with indices stored as type
+    static void Upload(const unsigned int *indices, size_t count, GLenum type, GLenum usage = GL_STATIC_DRAW)
+    {
+        if (type == GL_UNSIGNED_INT)
+        {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), indices, usage);
+            return;
+        }
+        std::vector<uint16_t> narrow(indices, indices + count);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(uint16_t), narrow.data(), usage);
+    }
+};
+
+#endif
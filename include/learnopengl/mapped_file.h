@@ -0,0 +1,133 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP 1
+#endif
+
+// read-only view of a whole file. It is memory mapped where mmap exists and read into memory elsewhere,
+// either way data() stays valid until the object is destroyed or Close is called.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile &operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    bool Open(const std::string &path)
+    {
+        Close();
+#ifdef MAPPED_FILE_MMAP
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+        struct stat info;
+        if (fstat(file, &info) != 0 || info.st_size == 0)
+        {
+            ::close(file);
+            return false;
+        }
+        void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        // the mapping keeps the file alive on its own
+        ::close(file);
+        if (mapping == MAP_FAILED)
+            return false;
+        bytes = (const unsigned char*)mapping;
+        length = info.st_size;
+        mapped = true;
+        return true;
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+        std::streamsize size = file.tellg();
+        if (size <= 0)
+            return false;
+        buffer.resize(size);
+        file.seekg(0);
+        if (!file.read((char*)buffer.data(), size))
+        {
+            buffer.clear();
+            return false;
+        }
+        bytes = buffer.data();
+        length = size;
+        return true;
+#endif
+    }
+
+    void Close()
+    {
+#ifdef MAPPED_FILE_MMAP
+        if (mapped)
+            munmap((void*)bytes, length);
+#endif
+        mapped = false;
+        buffer.clear();
+        buffer.shrink_to_fit();
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const unsigned char *data() const
+    {
+        return bytes;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    bool isOpen() const
+    {
+        return bytes != nullptr;
+    }
+
+    // 64 bit FNV-1a style hash of the whole file, eight bytes at a time
+    uint64_t hash() const
+    {
+        uint64_t h = 14695981039346656037ull;
+        size_t words = length / 8;
+        for (size_t i = 0; i < words; i++)
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i * 8, 8);
+            h ^= word;
+            h *= 1099511628211ull;
+        }
+        for (size_t i = words * 8; i < length; i++)
+        {
+            h ^= bytes[i];
+            h *= 1099511628211ull;
+        }
+        // the length keeps files that only differ by trailing zeros apart
+        h ^= length;
+        h *= 1099511628211ull;
+        return h;
+    }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::vector<unsigned char> buffer;
+};
+
+#endif
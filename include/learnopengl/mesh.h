@@ -7,8 +7,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/bounds.h>
+#include <learnopengl/index_buffer.h>
+#include <learnopengl/vertex_packing.h>
 
 #include <string>
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -33,72 +37,247 @@ struct Texture {
     string path;
 };
 
+// a texture and the unit the sampler reading it is set to
+struct SamplerBinding {
+    unsigned int unit;
+    unsigned int texture;
+};
+
+// where a program reads how to decode packed vertices, see Mesh::SetVertexDecode
+struct VertexDecodeUniforms {
+    UniformHandle<bool>      packed;
+    UniformHandle<glm::vec3> positionOffset;
+    UniformHandle<glm::vec3> positionScale;
+
+    static VertexDecodeUniforms Of(const Shader &shader)
+    {
+        VertexDecodeUniforms uniforms;
+        uniforms.packed = shader.getUniform<bool>(UNIFORM("packedVertices"));
+        uniforms.positionOffset = shader.getUniform<glm::vec3>(UNIFORM("positionOffset"));
+        uniforms.positionScale = shader.getUniform<glm::vec3>(UNIFORM("positionScale"));
+        return uniforms;
+    }
+};
+
+// whether a mesh built from vectors keeps them after the upload, only needed by code reading Mesh::vertices/indices
+enum MeshStorage {
+    KEEP_CPU_COPY,
+    GPU_ONLY
+};
+
+// a level of detail is a range of the index buffer, every level uses the same vertices
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+};
+
 class Mesh {
 public:
     // mesh Data
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    // levels of detail stored one after another in indices, the first one is the full mesh
+    vector<MeshLod>      lods;
+    // bounding volumes in model space
+    AABB           aabb;
+    BoundingSphere boundingSphere;
+    // layout of the vertex buffer, packed vertices are relative to positionDecode
+    VertexFormat vertexFormat = FULL_VERTICES;
+    VertexPacking::PositionDecode positionDecode;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, what the element buffer holds (indices is always unsigned int)
+    GLenum indexType = GL_UNSIGNED_INT;
 
     unsigned int VAO;
     std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // textures resolved against the samplers of boundProgram by BindShader, textures the program doesn't read are left out
+    vector<SamplerBinding> samplerBindings;
+    VertexDecodeUniforms vertexDecodeUniforms;
+    unsigned int boundProgram = 0;
+    // constructor, pass the vectors with std::move to hand them over without a copy.
+    // GPU_ONLY frees vertices and indices again once they are uploaded.
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, vector<MeshLod> lods = vector<MeshLod>(),
+         VertexFormat format = FULL_VERTICES, MeshStorage storage = KEEP_CPU_COPY)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), lods(std::move(lods))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        if (this->lods.empty())
+            this->lods.push_back(MeshLod{0, (unsigned int)this->indices.size()});
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size(), format);
+        if (storage == GPU_ONLY)
+        {
+            vector<Vertex>().swap(this->vertices);
+            vector<unsigned int>().swap(this->indices);
+        }
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // uploads vertex and index data straight from memory that outlives the call only briefly (e.g. a mapped
+    // cache file). No CPU copy is kept, vertices and indices stay empty.
+    Mesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount,
+         vector<Texture> textures, vector<MeshLod> lods, VertexFormat format = FULL_VERTICES)
+        : textures(std::move(textures)), lods(std::move(lods))
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        }
+        if (this->lods.empty())
+            this->lods.push_back(MeshLod{0, (unsigned int)indexCount});
+        setupMesh(vertexData, vertexCount, indexData, indexCount, format);
+    }
 
+    // render the mesh at the given level of detail
+    void Draw(Shader &shader, unsigned int lod = 0)
+    {
+        bindTextures(shader);
 
+        SetVertexDecode(vertexDecodeUniforms);
 
         // draw mesh
+        const MeshLod &level = getLod(lod);
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, level.indexCount, indexType, IndexBuffer::Offset(indexType, level.firstIndex));
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // render the mesh amount times in a single call, the model matrices are taken from the instance buffer
+    // starting at firstInstance
+    void DrawInstanced(Shader &shader, unsigned int amount, unsigned int lod = 0, unsigned int firstInstance = 0)
+    {
+        bindTextures(shader);
+        SetVertexDecode(vertexDecodeUniforms);
+
+        const MeshLod &level = getLod(lod);
+        glBindVertexArray(VAO);
+        SetFirstInstance(firstInstance);
+        glDrawElementsInstanced(GL_TRIANGLES, level.indexCount, indexType, IndexBuffer::Offset(indexType, level.firstIndex), amount);
+        glBindVertexArray(0);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // attaches a buffer of glm::mat4 model matrices to the VAO as a per-instance attribute (locations 5-8)
+    void SetInstanceBuffer(unsigned int instanceVBO)
+    {
+        this->instanceVBO = instanceVBO;
+        instanceBaseOffset = 0;
+        glBindVertexArray(VAO);
+        // a mat4 attribute takes up four consecutive locations, one per column
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(5 + i);
+            glVertexAttribDivisor(5 + i, 1);
+        }
+        setInstanceAttributes(0);
+        glBindVertexArray(0);
+    }
+
+    // looks up the sampler of every texture once and points it at the unit the program reserves for it.
+    // Draw does this itself when it is given another program, and glslIdentifierPrefix has to be set before.
+    void BindShader(Shader &shader)
+    {
+        shader.use();
+        samplerBindings.clear();
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            string name = SamplerName(i);
+            UniformName sampler{fnv1a(name.c_str()), name.c_str()};
+            GLint unit = shader.samplerUnit(sampler);
+            if (unit < 0)
+                continue;
+            shader.set(shader.getUniform<int>(sampler), unit);
+            samplerBindings.push_back(SamplerBinding{(unsigned int)unit, textures[i].id});
+        }
+        vertexDecodeUniforms = VertexDecodeUniforms::Of(shader);
+        boundProgram = shader.ID;
+    }
+
+    // tells the program in use how to read the vertex buffer
+    void SetVertexDecode(const VertexDecodeUniforms &uniforms) const
+    {
+        bool packed = vertexFormat == PACKED_VERTICES;
+        setUniformValue(uniforms.packed.location, packed);
+        if (packed)
+        {
+            setUniformValue(uniforms.positionOffset.location, positionDecode.offset);
+            setUniformValue(uniforms.positionScale.location, positionDecode.scale);
+        }
+    }
+
+    // moves the instance matrices to another buffer or another place in it (e.g. a StreamBuffer allocation),
+    // after SetInstanceBuffer enabled the attributes. The attributes follow on the next draw.
+    void SetInstanceSource(unsigned int instanceVBO, GLintptr baseOffset)
+    {
+        this->instanceVBO = instanceVBO;
+        instanceBaseOffset = baseOffset;
+    }
+
+    // OpenGL 3.3 has no base instance, so the instance attributes are moved to the first matrix instead.
+    // Expects the VAO to be bound.
+    void SetFirstInstance(unsigned int firstInstance)
+    {
+        GLintptr offset = instanceBaseOffset + firstInstance * sizeof(glm::mat4);
+        if (instanceVBO != instanceAttributeBuffer || offset != instanceAttributeOffset)
+            setInstanceAttributes(offset);
+    }
+
+    // name of the sampler uniform texture i is bound to, e.g. material.texture_diffuse1
+    string SamplerName(unsigned int i) const
+    {
+        // retrieve texture number (the N in diffuse_textureN)
+        unsigned int number = 1;
+        for (unsigned int j = 0; j < i; j++)
+            if (textures[j].type == textures[i].type)
+                number++;
+        return glslIdentifierPrefix + textures[i].type + std::to_string(number);
+    }
+
+    // the instance buffer belongs to whoever set it and stays
+    void Delete()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+
 private:
     // render data
     unsigned int VBO, EBO;
+    unsigned int instanceVBO = 0;
+    GLintptr instanceBaseOffset = 0;
+    // the buffer and byte offset the per-instance attributes currently point at
+    unsigned int instanceAttributeBuffer = 0;
+    GLintptr instanceAttributeOffset = -1;
+
+    const MeshLod &getLod(unsigned int lod) const
+    {
+        return lods[lod < lods.size() ? lod : lods.size() - 1];
+    }
+
+    // expects the VAO to be bound
+    void setInstanceAttributes(GLintptr offset)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (unsigned int i = 0; i < 4; i++)
+            glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + i * sizeof(glm::vec4)));
+        instanceAttributeBuffer = instanceVBO;
+        instanceAttributeOffset = offset;
+    }
+
+    // binds every texture the program reads to the unit of its sampler
+    void bindTextures(Shader &shader)
+    {
+        if (shader.ID != boundProgram)
+            BindShader(shader);
+        for (const SamplerBinding &binding: samplerBindings)
+        {
+            glActiveTexture(GL_TEXTURE0 + binding.unit);
+            glBindTexture(GL_TEXTURE_2D, binding.texture);
+        }
+    }
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount, VertexFormat format)
     {
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
@@ -106,15 +285,44 @@ private:
         glGenBuffers(1, &EBO);
 
         glBindVertexArray(VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        indexType = IndexBuffer::TypeFor(vertexCount);
+        IndexBuffer::Upload(indexData, indexCount, indexType);
+
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        vertexFormat = format;
+        if (format == PACKED_VERTICES)
+        {
+            // quantized against the bounds of exactly these vertices
+            AABB bounds;
+            for (size_t i = 0; i < vertexCount; i++)
+                bounds.expand(vertexData[i].Position);
+            positionDecode = VertexPacking::Decode(bounds);
+            vector<PackedVertex> packed;
+            VertexPacking::Pack(vertexData, vertexCount, bounds, packed);
+            glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+
+            // positions (w is the bitangent handedness)
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+            // octahedral normals
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+            // texture coords
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+            // tangent frame quaternion in place of tangent and bitangent
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 4, GL_UNSIGNED_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangentFrame));
+
+            glBindVertexArray(0);
+            return;
+        }
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -0,0 +1,299 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_import.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// binary copy of everything Model keeps from an Assimp import (vertices, indices with their levels of detail,
+// bounds and texture references), stored next to the source as <source>.meshcache.
+// The file starts with a header holding the hash of the source (SourceHash: the model file and the material
+// libraries it references) and the import version; a cache whose hash or version doesn't match is stale and gets
+// rewritten after the next import.
+// All arrays are 16 byte aligned in the file, so the vertices and indices of a mapped cache are handed to
+// glBufferData as they are. The asset cooker stores the same bytes in the asset pack.
+class MeshCache
+{
+public:
+    // bump whenever the import produces different data (post processing, simplification, vertex layout)
+    static const uint32_t VERSION = 2;
+
+    // one mesh inside the cache data, the pointers stay valid while the cache file is open (or the pack mounted)
+    struct MeshView {
+        const Vertex *vertices;
+        uint32_t vertexCount;
+        const unsigned int *indices;
+        uint32_t indexCount;
+        std::vector<MeshLod> lods;
+        std::vector<TextureReference> textures;
+        AABB aabb;
+        BoundingSphere sphere;
+    };
+
+    static std::string PathFor(const std::string &source)
+    {
+        return source + ".meshcache";
+    }
+
+    // hash of the model file combined with every material library (mtllib of .obj files) it names, so editing
+    // the materials invalidates the cache as well. 0 when the model can't be read.
+    static uint64_t SourceHash(const std::string &path)
+    {
+        MappedFile source;
+        if (!source.Open(path))
+            return 0;
+        uint64_t h = source.hash();
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        const char *text = (const char*)source.data();
+        size_t size = source.size();
+        for (size_t line = 0; line < size;)
+        {
+            size_t end = line;
+            while (end < size && text[end] != '\n' && text[end] != '\r')
+                end++;
+            if (end - line > 7 && std::strncmp(text + line, "mtllib", 6) == 0 && (text[line + 6] == ' ' || text[line + 6] == '\t'))
+            {
+                size_t first = line + 7, last = end;
+                while (first < last && (text[first] == ' ' || text[first] == '\t'))
+                    first++;
+                while (last > first && (text[last - 1] == ' ' || text[last - 1] == '\t'))
+                    last--;
+                MappedFile library;
+                // a missing library still counts, it shows up once it is added
+                uint64_t libraryHash = library.Open(directory + std::string(text + first, last - first)) ? library.hash() : 0;
+                h ^= libraryHash;
+                h *= 1099511628211ull;
+            }
+            line = end + 1;
+        }
+        return h;
+    }
+
+    // maps the cache and checks it against the hash of the current source, false when missing, stale or broken
+    bool Open(const std::string &cachePath, uint64_t sourceHash)
+    {
+        Close();
+        if (!file.Open(cachePath))
+            return false;
+        if (!Parse(file.data(), file.size(), sourceHash))
+        {
+            file.Close();
+            return false;
+        }
+        return true;
+    }
+
+    // reads a cache that is already in memory (e.g. an entry of the asset pack), data has to outlive the mesh views
+    bool Parse(const unsigned char *data, size_t size, uint64_t sourceHash)
+    {
+        meshes.clear();
+        if (!parse(data, size, sourceHash))
+        {
+            meshes.clear();
+            return false;
+        }
+        return true;
+    }
+
+    const std::vector<MeshView> &Meshes() const
+    {
+        return meshes;
+    }
+
+    // unmaps the file, the mesh views are invalid afterwards
+    void Close()
+    {
+        meshes.clear();
+        file.Close();
+    }
+
+    // the whole cache file for the given meshes, empty when a mesh has no geometry
+    static std::vector<unsigned char> Serialize(uint64_t sourceHash, const std::vector<ImportedMesh> &source)
+    {
+        std::vector<unsigned char> blob;
+        Header header;
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.sourceHash = sourceHash;
+        header.vertexSize = sizeof(Vertex);
+        header.meshCount = source.size();
+        append(blob, &header, sizeof(header));
+        size_t recordsOffset = blob.size();
+        blob.resize(blob.size() + source.size() * sizeof(MeshRecord));
+
+        for (unsigned int m = 0; m < source.size(); m++)
+        {
+            const ImportedMesh &mesh = source[m];
+            if (mesh.vertices.empty() || mesh.indices.empty())
+                return std::vector<unsigned char>();
+            MeshRecord record;
+            record.vertexCount = mesh.vertices.size();
+            record.indexCount = mesh.indices.size();
+            record.lodCount = mesh.lods.size();
+            record.textureCount = mesh.textures.size();
+            for (int k = 0; k < 3; k++)
+            {
+                record.aabbMin[k] = mesh.aabb.min[k];
+                record.aabbMax[k] = mesh.aabb.max[k];
+                record.sphere[k] = mesh.boundingSphere.center[k];
+            }
+            record.sphere[3] = mesh.boundingSphere.radius;
+
+            record.vertexOffset = align(blob);
+            append(blob, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            record.indexOffset = align(blob);
+            append(blob, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+            record.lodOffset = align(blob);
+            append(blob, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+            record.textureOffset = align(blob);
+            for (const TextureReference &texture: mesh.textures)
+            {
+                uint32_t lengths[2] = {(uint32_t)texture.type.size(), (uint32_t)texture.path.size()};
+                append(blob, lengths, sizeof(lengths));
+                append(blob, texture.type.data(), texture.type.size());
+                append(blob, texture.path.data(), texture.path.size());
+            }
+            std::memcpy(&blob[recordsOffset + m * sizeof(MeshRecord)], &record, sizeof(record));
+        }
+        return blob;
+    }
+
+    static bool Write(const std::string &cachePath, uint64_t sourceHash, const std::vector<ImportedMesh> &source)
+    {
+        std::vector<unsigned char> blob = Serialize(sourceHash, source);
+        if (blob.empty())
+            return false;
+        // written under another name first so a crash never leaves a half written cache behind
+        std::string temporaryPath = cachePath + ".tmp";
+        {
+            std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!out || !out.write((const char*)blob.data(), blob.size()))
+            {
+                std::cout << "ERROR::MESH_CACHE:: could not write " << temporaryPath << std::endl;
+                return false;
+            }
+        }
+        if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0)
+        {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static const uint32_t MAGIC = 0x4853454d; // "MESH"
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t vertexSize;
+        uint32_t meshCount;
+        uint32_t reserved[2] = {0, 0};
+    };
+
+    struct MeshRecord {
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t lodCount;
+        uint32_t textureCount;
+        float aabbMin[3];
+        float aabbMax[3];
+        float sphere[4];
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint64_t lodOffset;
+        uint64_t textureOffset;
+    };
+
+    MappedFile file;
+    std::vector<MeshView> meshes;
+
+    static void append(std::vector<unsigned char> &blob, const void *data, size_t size)
+    {
+        const unsigned char *bytes = (const unsigned char*)data;
+        blob.insert(blob.end(), bytes, bytes + size);
+    }
+
+    // pads the blob to the next 16 bytes and returns the new end
+    static uint64_t align(std::vector<unsigned char> &blob)
+    {
+        blob.resize((blob.size() + 15) & ~size_t(15), 0);
+        return blob.size();
+    }
+
+    static bool inside(size_t total, uint64_t offset, uint64_t size)
+    {
+        return offset <= total && size <= total - offset;
+    }
+
+    bool parse(const unsigned char *data, size_t total, uint64_t sourceHash)
+    {
+        Header header;
+        if (!inside(total, 0, sizeof(header)))
+            return false;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != MAGIC || header.version != VERSION || header.sourceHash != sourceHash ||
+            header.vertexSize != sizeof(Vertex))
+            return false;
+        if (!inside(total, sizeof(header), uint64_t(header.meshCount) * sizeof(MeshRecord)))
+            return false;
+
+        for (uint32_t m = 0; m < header.meshCount; m++)
+        {
+            MeshRecord record;
+            std::memcpy(&record, data + sizeof(header) + m * sizeof(MeshRecord), sizeof(record));
+            if (!inside(total, record.vertexOffset, uint64_t(record.vertexCount) * sizeof(Vertex)) ||
+                !inside(total, record.indexOffset, uint64_t(record.indexCount) * sizeof(unsigned int)) ||
+                !inside(total, record.lodOffset, uint64_t(record.lodCount) * sizeof(MeshLod)) ||
+                record.vertexOffset % 16 != 0 || record.indexOffset % 16 != 0)
+                return false;
+
+            MeshView view;
+            view.vertices = (const Vertex*)(data + record.vertexOffset);
+            view.vertexCount = record.vertexCount;
+            view.indices = (const unsigned int*)(data + record.indexOffset);
+            view.indexCount = record.indexCount;
+            view.lods.resize(record.lodCount);
+            std::memcpy(view.lods.data(), data + record.lodOffset, record.lodCount * sizeof(MeshLod));
+            for (const MeshLod &lod: view.lods)
+                if (uint64_t(lod.firstIndex) + lod.indexCount > record.indexCount)
+                    return false;
+
+            uint64_t offset = record.textureOffset;
+            for (uint32_t t = 0; t < record.textureCount; t++)
+            {
+                uint32_t lengths[2];
+                if (!inside(total, offset, sizeof(lengths)))
+                    return false;
+                std::memcpy(lengths, data + offset, sizeof(lengths));
+                offset += sizeof(lengths);
+                if (!inside(total, offset, uint64_t(lengths[0]) + lengths[1]))
+                    return false;
+                TextureReference texture;
+                texture.type.assign((const char*)data + offset, lengths[0]);
+                texture.path.assign((const char*)data + offset + lengths[0], lengths[1]);
+                offset += lengths[0] + lengths[1];
+                view.textures.push_back(texture);
+            }
+
+            view.aabb.min = glm::vec3(record.aabbMin[0], record.aabbMin[1], record.aabbMin[2]);
+            view.aabb.max = glm::vec3(record.aabbMax[0], record.aabbMax[1], record.aabbMax[2]);
+            view.sphere.center = glm::vec3(record.sphere[0], record.sphere[1], record.sphere[2]);
+            view.sphere.radius = record.sphere[3];
+            meshes.push_back(view);
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+#include <glm/glm.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/simplify.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// a texture a mesh's material refers to, path is relative to the model's directory
+struct TextureReference {
+    string type;
+    string path;
+};
+
+// everything Model keeps from an import, before anything is uploaded
+struct ImportedMesh {
+    vector<Vertex>           vertices;
+    vector<unsigned int>     indices;
+    // levels of detail stored one after another in indices, the first one is the full mesh
+    vector<MeshLod>          lods;
+    vector<TextureReference> textures;
+    AABB           aabb;
+    BoundingSphere boundingSphere;
+};
+
+// reads a model through Assimp and builds the levels of detail. Doesn't touch GL, so the asset cooker uses it
+// as well as Model.
+class MeshImporter
+{
+public:
+    static bool Import(const string &path, vector<ImportedMesh> &meshes)
+    {
+        // read file via ASSIMP
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace |
+                                                       aiProcess_JoinIdenticalVertices);
+        // check for errors
+        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+        {
+            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+            return false;
+        }
+        // process ASSIMP's root node recursively
+        meshes.reserve(meshes.size() + scene->mNumMeshes);
+        processNode(scene->mRootNode, scene, meshes);
+        return true;
+    }
+
+private:
+    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
+    static void processNode(aiNode *node, const aiScene *scene, vector<ImportedMesh> &meshes)
+    {
+        // process each mesh located at the current node
+        for(unsigned int i = 0; i < node->mNumMeshes; i++)
+        {
+            // the node object only contains indices to index the actual objects in the scene.
+            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
+            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+            meshes.push_back(processMesh(mesh, scene));
+        }
+        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+        for(unsigned int i = 0; i < node->mNumChildren; i++)
+        {
+            processNode(node->mChildren[i], scene, meshes);
+        }
+
+    }
+
+    static ImportedMesh processMesh(aiMesh *mesh, const aiScene *scene)
+    {
+        // data to fill
+        ImportedMesh result;
+        vector<Vertex> &vertices = result.vertices;
+        vector<unsigned int> &indices = result.indices;
+        AABB &aabb = result.aabb;
+        vertices.reserve(mesh->mNumVertices);
+        // triangulated, the levels of detail add at most as many indices again
+        indices.reserve(size_t(mesh->mNumFaces) * 3 * 2);
+
+        // walk through each of the mesh's vertices
+        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
+        {
+            Vertex vertex;
+            glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
+            // positions
+            vector.x = mesh->mVertices[i].x;
+            vector.y = mesh->mVertices[i].y;
+            vector.z = mesh->mVertices[i].z;
+            vertex.Position = vector;
+            aabb.expand(vector);
+            // normals
+            if (mesh->HasNormals())
+            {
+                vector.x = mesh->mNormals[i].x;
+                vector.y = mesh->mNormals[i].y;
+                vector.z = mesh->mNormals[i].z;
+                vertex.Normal = vector;
+            }
+            // texture coordinates
+            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+            {
+                glm::vec2 vec;
+                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
+                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+                vec.x = mesh->mTextureCoords[0][i].x;
+                vec.y = mesh->mTextureCoords[0][i].y;
+                vertex.TexCoords = vec;
+                // tangent
+                vector.x = mesh->mTangents[i].x;
+                vector.y = mesh->mTangents[i].y;
+                vector.z = mesh->mTangents[i].z;
+                vertex.Tangent = vector;
+                // bitangent
+                vector.x = mesh->mBitangents[i].x;
+                vector.y = mesh->mBitangents[i].y;
+                vector.z = mesh->mBitangents[i].z;
+                vertex.Bitangent = vector;
+            }
+            else
+            {
+                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+                // welding compares whole vertices
+                vertex.Tangent = glm::vec3(0.0f);
+                vertex.Bitangent = glm::vec3(0.0f);
+            }
+
+            vertices.push_back(vertex);
+
+
+        }
+        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+        {
+            aiFace face = mesh->mFaces[i];
+            // retrieve all indices of the face and store them in the indices vector
+            for(unsigned int j = 0; j < face.mNumIndices; j++)
+                indices.push_back(face.mIndices[j]);
+        }
+        // exact duplicates left after Assimp would split the seams the simplifier sees
+        MeshOptimizer::Weld(vertices, indices);
+        MeshOptimizer::Stats before = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+        size_t vertexCountBefore = vertices.size();
+        // levels of detail, simplified one from another and appended after the full index list
+        vector<MeshLod> &lods = result.lods;
+        lods.push_back(MeshLod{0, (unsigned int)indices.size()});
+        const float lodRatios[] = {0.5f, 0.25f, 0.1f};
+        size_t fullIndexCount = indices.size();
+        vector<unsigned int> lodIndices = indices;
+        for (float ratio: lodRatios)
+        {
+            lodIndices = MeshSimplifier::Simplify(vertices, lodIndices, (size_t)(fullIndexCount * ratio) / 3 * 3);
+            // stop once collapses are no longer possible
+            if (lodIndices.empty() || lodIndices.size() >= lods.back().indexCount)
+                break;
+            lods.push_back(MeshLod{(unsigned int)indices.size(), (unsigned int)lodIndices.size()});
+            indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+        }
+        // triangle order of every level for the vertex cache, then for overdraw, then vertices in fetch order
+        for (const MeshLod &lod: lods)
+        {
+            MeshOptimizer::OptimizeVertexCache(&indices[lod.firstIndex], lod.indexCount, vertices.size());
+            MeshOptimizer::OptimizeOverdraw(&indices[lod.firstIndex], lod.indexCount, vertices);
+        }
+        MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+        MeshOptimizer::Stats after = MeshOptimizer::AnalyzeVertexCache(indices.data(), lods[0].indexCount, vertices.size());
+        cout << "MESH_OPTIMIZER:: " << mesh->mName.C_Str() << ": " << vertexCountBefore << " -> " << vertices.size()
+             << " vertices, ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << endl;
+        // process materials
+        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
+        // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
+        // Same applies to other texture as the following list summarizes:
+        // diffuse: texture_diffuseN
+        // specular: texture_specularN
+        // normal: texture_normalN
+
+        // 1. diffuse maps
+        materialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", result.textures);
+        // 2. specular maps
+        materialTextures(material, aiTextureType_SPECULAR, "texture_specular", result.textures);
+        // 3. normal maps
+        materialTextures(material, aiTextureType_HEIGHT, "texture_normal", result.textures);
+        // 4. height maps
+        materialTextures(material, aiTextureType_AMBIENT, "texture_height", result.textures);
+
+        // bounding sphere around the box center, radius is the farthest vertex
+        result.boundingSphere.center = aabb.center();
+        for (const Vertex& vertex: vertices)
+            result.boundingSphere.radius = glm::max(result.boundingSphere.radius, glm::length(vertex.Position - result.boundingSphere.center));
+        return result;
+    }
+
+    // appends the textures of the given type the material uses
+    static void materialTextures(aiMaterial *mat, aiTextureType type, const string &typeName, vector<TextureReference> &textures)
+    {
+        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        {
+            aiString str;
+            mat->GetTexture(type, i, &str);
+            textures.push_back(TextureReference{typeName, str.C_Str()});
+        }
+    }
+};
+
+#endif
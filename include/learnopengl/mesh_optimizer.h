@@ -0,0 +1,320 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// reorders a mesh for the GPU after import:
+//  1. Weld merges vertices that are identical in every attribute.
+//  2. OptimizeVertexCache orders triangles for the post-transform cache (Forsyth, "Linear-Speed Vertex Cache
+//     Optimisation"): greedily the triangle whose vertices score highest, by position in a simulated LRU
+//     cache and by how few triangles still use them.
+//  3. OptimizeOverdraw cuts that order into clusters where the cache starts over anyway and sorts the clusters
+//     by how far out they face (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced
+//     Overdraw"), so the outer shell tends to be drawn first from any side.
+//  4. OptimizeVertexFetch puts vertices in the order the indices first use them and drops unused ones.
+// Stats are measured with a FIFO cache like the hardware has.
+class MeshOptimizer
+{
+public:
+    struct Stats {
+        // transformed vertices per triangle, 0.5 is the best a regular grid reaches and 3 the worst
+        float acmr = 0.0f;
+        // transformed vertices per vertex, 1 is ideal
+        float atvr = 0.0f;
+    };
+
+    // FIFO cache simulation over indices
+    static Stats AnalyzeVertexCache(const unsigned int *indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16)
+    {
+        Stats stats;
+        if (indexCount < 3)
+            return stats;
+        vector<unsigned int> timestamp(vertexCount, 0);
+        vector<bool> used(vertexCount, false);
+        unsigned int time = cacheSize + 1, misses = 0, unique = 0;
+        for (size_t i = 0; i < indexCount; i++)
+        {
+            unsigned int v = indices[i];
+            if (!used[v])
+            {
+                used[v] = true;
+                unique++;
+            }
+            // the entry is still in the cache when fewer than cacheSize misses happened since it went in
+            if (time - timestamp[v] > cacheSize)
+            {
+                timestamp[v] = time++;
+                misses++;
+            }
+        }
+        stats.acmr = float(misses) / (indexCount / 3);
+        stats.atvr = float(misses) / unique;
+        return stats;
+    }
+
+    // merges bitwise identical vertices, the indices are rewritten and unused vertices stay in place until
+    // OptimizeVertexFetch. Returns the number of vertices merged away.
+    static size_t Weld(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        // open addressing over vertex numbers, at most half full
+        size_t tableSize = 1;
+        while (tableSize < vertices.size() * 2)
+            tableSize *= 2;
+        vector<unsigned int> table(tableSize, ~0u);
+        vector<unsigned int> remap(vertices.size());
+        size_t merged = 0;
+        for (unsigned int i = 0; i < vertices.size(); i++)
+        {
+            size_t slot = hashVertex(vertices[i]) & (tableSize - 1);
+            while (table[slot] != ~0u && std::memcmp(&vertices[table[slot]], &vertices[i], sizeof(Vertex)) != 0)
+                slot = (slot + 1) & (tableSize - 1);
+            if (table[slot] == ~0u)
+                table[slot] = i;
+            else
+                merged++;
+            remap[i] = table[slot];
+        }
+        for (unsigned int &index: indices)
+            index = remap[index];
+        return merged;
+    }
+
+    // reorders the triangles of indices[0, indexCount) in place
+    static void OptimizeVertexCache(unsigned int *indices, size_t indexCount, size_t vertexCount)
+    {
+        unsigned int triangleCount = indexCount / 3;
+        if (triangleCount == 0)
+            return;
+
+        // triangles of every vertex, the first liveTriangles[v] of them are not emitted yet
+        vector<unsigned int> liveTriangles(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            liveTriangles[indices[i]]++;
+        vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++)
+            adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+        vector<unsigned int> adjacency(triangleCount * 3);
+        {
+            vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (unsigned int t = 0; t < triangleCount; t++)
+                for (unsigned int k = 0; k < 3; k++)
+                    adjacency[fill[indices[t * 3 + k]]++] = t;
+        }
+
+        vector<int> cachePosition(vertexCount, -1);
+        vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            vertexScore[v] = scoreVertex(-1, liveTriangles[v]);
+        vector<float> triangleScore(triangleCount);
+        vector<bool> emitted(triangleCount, false);
+        unsigned int best = 0;
+        for (unsigned int t = 0; t < triangleCount; t++)
+        {
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+            if (triangleScore[t] > triangleScore[best])
+                best = t;
+        }
+
+        vector<unsigned int> result;
+        result.reserve(triangleCount * 3);
+        // room for the three vertices of the new triangle in front of a full cache
+        unsigned int cache[SCORE_CACHE_SIZE + 3], nextCache[SCORE_CACHE_SIZE + 3];
+        unsigned int cacheSize = 0;
+        unsigned int cursor = 0;
+        while (result.size() < triangleCount * 3)
+        {
+            emitted[best] = true;
+            const unsigned int *triangle = &indices[best * 3];
+            unsigned int nextSize = 0;
+            for (unsigned int k = 0; k < 3; k++)
+            {
+                unsigned int v = triangle[k];
+                result.push_back(v);
+                nextCache[nextSize++] = v;
+                // drop the triangle from the live ones of v
+                unsigned int *begin = &adjacency[adjacencyOffset[v]];
+                unsigned int *live = std::find(begin, begin + liveTriangles[v], best);
+                std::swap(*live, begin[liveTriangles[v] - 1]);
+                liveTriangles[v]--;
+            }
+            for (unsigned int i = 0; i < cacheSize; i++)
+            {
+                unsigned int v = cache[i];
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                    nextCache[nextSize++] = v;
+            }
+
+            // rescore everything that is in the cache or just fell out of it
+            best = ~0u;
+            float bestScore = -1.0f;
+            for (unsigned int i = 0; i < nextSize; i++)
+            {
+                unsigned int v = nextCache[i];
+                cachePosition[v] = i < SCORE_CACHE_SIZE ? (int)i : -1;
+                float score = scoreVertex(cachePosition[v], liveTriangles[v]);
+                float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+                for (unsigned int j = 0; j < liveTriangles[v]; j++)
+                {
+                    unsigned int t = adjacency[adjacencyOffset[v] + j];
+                    triangleScore[t] += delta;
+                    if (triangleScore[t] > bestScore)
+                    {
+                        bestScore = triangleScore[t];
+                        best = t;
+                    }
+                }
+            }
+            cacheSize = std::min(nextSize, (unsigned int)SCORE_CACHE_SIZE);
+            std::copy(nextCache, nextCache + cacheSize, cache);
+
+            // nothing left next to the cache, continue with the next triangle in input order
+            if (best == ~0u)
+            {
+                while (cursor < triangleCount && emitted[cursor])
+                    cursor++;
+                if (cursor == triangleCount)
+                    break;
+                best = cursor;
+            }
+        }
+        std::copy(result.begin(), result.end(), indices);
+    }
+
+    // sorts the clusters of a cache optimized triangle order front faces first, seen from outside
+    static void OptimizeOverdraw(unsigned int *indices, size_t indexCount, const vector<Vertex> &vertices, unsigned int cacheSize = 16)
+    {
+        unsigned int triangleCount = indexCount / 3;
+        if (triangleCount < 2)
+            return;
+
+        // a cluster starts wherever all three vertices of a triangle miss the cache, cutting there costs nothing
+        vector<unsigned int> clusterStarts;
+        vector<unsigned int> timestamp(vertices.size(), 0);
+        unsigned int time = cacheSize + 1;
+        for (unsigned int t = 0; t < triangleCount; t++)
+        {
+            unsigned int misses = 0;
+            for (unsigned int k = 0; k < 3; k++)
+            {
+                unsigned int v = indices[t * 3 + k];
+                if (time - timestamp[v] > cacheSize)
+                {
+                    timestamp[v] = time++;
+                    misses++;
+                }
+            }
+            if (t == 0 || misses == 3)
+                clusterStarts.push_back(t);
+        }
+        clusterStarts.push_back(triangleCount);
+        unsigned int clusterCount = clusterStarts.size() - 1;
+        if (clusterCount < 2)
+            return;
+
+        // area weighted centroid and normal of every cluster and of the whole mesh
+        vector<glm::vec3> centroids(clusterCount), normals(clusterCount);
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for (unsigned int c = 0; c < clusterCount; c++)
+        {
+            glm::vec3 centroid(0.0f), normal(0.0f);
+            float area = 0.0f;
+            for (unsigned int t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+            {
+                const glm::vec3 &a = vertices[indices[t * 3]].Position;
+                const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3 &d = vertices[indices[t * 3 + 2]].Position;
+                glm::vec3 cross = glm::cross(b - a, d - a);
+                float triangleArea = glm::length(cross);
+                centroid += (a + b + d) * (triangleArea / 3.0f);
+                normal += cross;
+                area += triangleArea;
+            }
+            meshCentroid += centroid;
+            meshArea += area;
+            centroids[c] = area > 0.0f ? centroid / area : vertices[indices[clusterStarts[c] * 3]].Position;
+            float length = glm::length(normal);
+            normals[c] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+        }
+        if (meshArea > 0.0f)
+            meshCentroid /= meshArea;
+
+        vector<float> facing(clusterCount);
+        vector<unsigned int> order(clusterCount);
+        for (unsigned int c = 0; c < clusterCount; c++)
+        {
+            facing[c] = glm::dot(centroids[c] - meshCentroid, normals[c]);
+            order[c] = c;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return facing[a] > facing[b]; });
+
+        vector<unsigned int> result;
+        result.reserve(triangleCount * 3);
+        for (unsigned int c: order)
+            result.insert(result.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+        std::copy(result.begin(), result.end(), indices);
+    }
+
+    // orders vertices by first use in indices and drops the ones no index refers to
+    static void OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        vector<unsigned int> remap(vertices.size(), ~0u);
+        vector<Vertex> ordered;
+        ordered.reserve(vertices.size());
+        for (unsigned int &index: indices)
+        {
+            if (remap[index] == ~0u)
+            {
+                remap[index] = ordered.size();
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(ordered);
+    }
+
+private:
+    // Forsyth's tuning
+    static const unsigned int SCORE_CACHE_SIZE = 32;
+
+    static uint32_t hashVertex(const Vertex &vertex)
+    {
+        uint32_t words[sizeof(Vertex) / 4];
+        std::memcpy(words, &vertex, sizeof(Vertex));
+        uint32_t h = 2166136261u;
+        for (uint32_t word: words)
+            h = (h ^ word) * 16777619u;
+        // fnv spreads the low bits poorly for float data, mix once more
+        h ^= h >> 15;
+        return h * 0x2c1b3c6du;
+    }
+
+    static float scoreVertex(int cachePosition, unsigned int liveTriangles)
+    {
+        // no triangle needs it anymore
+        if (liveTriangles == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            // the last triangle's vertices get a fixed score so its neighbours don't win just by sharing an edge
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - float(cachePosition - 3) / (SCORE_CACHE_SIZE - 3), 1.5f);
+        }
+        // vertices with few triangles left are finished first, so they can leave the cache
+        return score + 2.0f / std::sqrt((float)liveTriangles);
+    }
+};
+
+#endif
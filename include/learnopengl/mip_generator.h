@@ -0,0 +1,161 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2 1
+#endif
+
+// builds mip chains on the CPU, so textures can be uploaded with every level instead of calling glGenerateMipmap
+// on the GL thread. Every level averages 2x2 texels of the one above (rounding the sides down like GL does).
+// sRGB color channels are averaged in linear light through lookup tables, alpha and non-sRGB data as it is,
+// RGBA and single channel rows eight bytes at a time with SSE2 where it is available.
+class MipGenerator
+{
+public:
+    static unsigned int LevelCount(unsigned int width, unsigned int height)
+    {
+        unsigned int levels = 1;
+        while ((width >> levels) > 0 || (height >> levels) > 0)
+            levels++;
+        return levels;
+    }
+
+    // bytes of level 1 and below with tightly packed rows, one level after another
+    static size_t ChainSize(unsigned int width, unsigned int height, unsigned int channels)
+    {
+        size_t size = 0;
+        for (unsigned int level = 1; level < LevelCount(width, height); level++)
+            size += size_t(std::max(1u, width >> level)) * std::max(1u, height >> level) * channels;
+        return size;
+    }
+
+    // writes level 1 and below of level0 to chain (ChainSize bytes)
+    static void Generate(const unsigned char *level0, unsigned int width, unsigned int height, unsigned int channels, bool srgb,
+                         unsigned char *chain)
+    {
+        const unsigned char *source = level0;
+        for (unsigned int level = 1; level < LevelCount(width, height); level++)
+        {
+            unsigned int sourceWidth = std::max(1u, width >> (level - 1)), sourceHeight = std::max(1u, height >> (level - 1));
+            Downsample(source, sourceWidth, sourceHeight, channels, srgb, chain);
+            source = chain;
+            chain += size_t(std::max(1u, sourceWidth / 2)) * std::max(1u, sourceHeight / 2) * channels;
+        }
+    }
+
+    // the next smaller level of source into destination. srgb treats the first three channels as sRGB encoded
+    // (1 and 2 channel images never are).
+    static void Downsample(const unsigned char *source, unsigned int width, unsigned int height, unsigned int channels, bool srgb,
+                           unsigned char *destination)
+    {
+        unsigned int w = std::max(1u, width / 2), h = std::max(1u, height / 2);
+        srgb = srgb && channels >= 3;
+        for (unsigned int y = 0; y < h; y++)
+        {
+            const unsigned char *row0 = source + size_t(std::min(y * 2, height - 1)) * width * channels;
+            const unsigned char *row1 = source + size_t(std::min(y * 2 + 1, height - 1)) * width * channels;
+            unsigned char *out = destination + size_t(y) * w * channels;
+            unsigned int x = 0;
+            if (!srgb && width > 1)
+                x = averageRow(row0, row1, w, channels, out);
+            for (; x < w; x++)
+            {
+                unsigned int x0 = std::min(x * 2, width - 1) * channels, x1 = std::min(x * 2 + 1, width - 1) * channels;
+                for (unsigned int c = 0; c < channels; c++)
+                {
+                    if (srgb && c < 3)
+                    {
+                        const Tables &tables = get();
+                        uint32_t sum = tables.linear[row0[x0 + c]] + tables.linear[row0[x1 + c]] +
+                                       tables.linear[row1[x0 + c]] + tables.linear[row1[x1 + c]];
+                        out[x * channels + c] = tables.encode[(sum + 2) >> 2];
+                    }
+                    else
+                        out[x * channels + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2;
+                }
+            }
+        }
+    }
+
+private:
+    // sRGB to 16 bit linear and back
+    struct Tables {
+        uint16_t linear[256];
+        unsigned char encode[65536];
+
+        Tables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+                float l = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                linear[i] = (uint16_t)(l * 65535.0f + 0.5f);
+            }
+            for (int i = 0; i < 65536; i++)
+            {
+                float l = i / 65535.0f;
+                float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                encode[i] = (unsigned char)std::min(255.0f, c * 255.0f + 0.5f);
+            }
+        }
+    };
+
+    static const Tables &get()
+    {
+        static const Tables tables;
+        return tables;
+    }
+
+    // the vectorized part of a row of linear data, returns the number of texels written
+    static unsigned int averageRow(const unsigned char *row0, const unsigned char *row1, unsigned int w, unsigned int channels,
+                                   unsigned char *out)
+    {
+        unsigned int x = 0;
+#ifdef MIP_GENERATOR_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        if (channels == 4)
+        {
+            // 4 source texels of both rows make 2 texels
+            for (; x + 2 <= w; x += 2)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+                __m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+                __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                // texels 0 and 2 plus texels 1 and 3
+                __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+                _mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(sum, sum));
+            }
+        }
+        else if (channels == 1)
+        {
+            // 16 source texels of both rows make 8 texels
+            const __m128i ones = _mm_set1_epi16(1);
+            const __m128i two32 = _mm_set1_epi32(2);
+            for (; x + 8 <= w; x += 8)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 2));
+                __m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 2));
+                __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                // neighbouring pairs
+                __m128i sumLow = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(low, ones), two32), 2);
+                __m128i sumHigh = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(high, ones), two32), 2);
+                __m128i sum = _mm_packs_epi32(sumLow, sumHigh);
+                _mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(sum, sum));
+            }
+        }
+#endif
+        return x;
+    }
+};
+
+#endif
@@ -6,12 +6,17 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <stb_image.h>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
 
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/mapped_file.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_import.h>
+#include <learnopengl/render_queue.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/stream_buffer.h>
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/texture_loader.h>
 
 #include <string>
 #include <fstream>
@@ -29,13 +34,34 @@ class Model
 {
 public:
     // model data
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    // the textures of all meshes, shared with every other model and loader of the same files through TextureCache
+    vector<TextureCache::Handle> textureHandles;
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // layout the vertex buffers of the meshes are built with
+    VertexFormat vertexFormat;
+    // whether meshes keep vertices and indices after the upload (meshes from a cache never do)
+    MeshStorage meshStorage;
+    // bounding volumes of all meshes together, in model space
+    AABB           aabb;
+    BoundingSphere boundingSphere;
+    // per-instance model matrices shared by all meshes of the model, sorted by level of detail
+    unsigned int instanceVBO = 0;
+    unsigned int instanceCapacity = 0;
+    // when set, the matrices are written into this frame's part of the stream instead of instanceVBO
+    StreamBuffer *instanceStream = nullptr;
+    vector<unsigned int> lodInstanceCounts;
+    // distance from the viewer at which level i + 1 replaces level i
+    vector<float> lodDistances = {20.0f, 45.0f, 80.0f};
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // with a textureLoader the textures are decoded in the background and only usable after its Finish.
+    // PACKED_VERTICES quantizes the vertices for drawing, the shaders have to decode them (see omnishader.vs).
+    // GPU_ONLY frees the vertices and indices of every mesh once they are uploaded.
+    Model(string const &path, bool gamma = false, TextureLoader *textureLoader = nullptr, VertexFormat vertexFormat = FULL_VERTICES,
+          MeshStorage meshStorage = KEEP_CPU_COPY)
+        : gammaCorrection(gamma), vertexFormat(vertexFormat), meshStorage(meshStorage), textureLoader(textureLoader)
     {
         loadModel(path);
     }
@@ -47,218 +73,226 @@ public:
             meshes[i].Draw(shader);
     }
 
-    void SetShaderTextureNamePrefix(std::string prefix) {
-        for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
-        }
-    }
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    // draws the model with the level of detail that fits the distance to the viewer
+    void Draw(Shader &shader, float distance)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
-        }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        unsigned int lod = SelectLod(distance);
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader, lod);
+    }
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+    unsigned int SelectLod(float distance) const
+    {
+        unsigned int lod = 0;
+        while (lod < lodDistances.size() && distance >= lodDistances[lod])
+            lod++;
+        return lod;
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // draws every mesh once for each instance set with SetInstanceMatrices, one draw call per mesh and level of detail
+    void DrawInstanced(Shader &shader)
     {
-        // process each mesh located at the current node
-        for(unsigned int i = 0; i < node->mNumMeshes; i++)
+        unsigned int firstInstance = 0;
+        for (unsigned int lod = 0; lod < lodInstanceCounts.size(); lod++)
         {
-            // the node object only contains indices to index the actual objects in the scene.
-            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            if (lodInstanceCounts[lod] == 0)
+                continue;
+            for(unsigned int i = 0; i < meshes.size(); i++)
+                meshes[i].DrawInstanced(shader, lodInstanceCounts[lod], lod, firstInstance);
+            firstInstance += lodInstanceCounts[lod];
         }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-        for(unsigned int i = 0; i < node->mNumChildren; i++)
+    }
+
+    // queues the same draws as DrawInstanced, every level is sorted at the distance it starts at
+    void SubmitInstanced(RenderQueue &queue, Shader &shader)
+    {
+        unsigned int firstInstance = 0;
+        for (unsigned int lod = 0; lod < lodInstanceCounts.size(); lod++)
         {
-            processNode(node->mChildren[i], scene);
+            if (lodInstanceCounts[lod] == 0)
+                continue;
+            float depth = lod == 0 ? 0.0f : lodDistances[lod - 1];
+            for(unsigned int i = 0; i < meshes.size(); i++)
+                queue.SubmitMeshInstanced(meshes[i], shader, lodInstanceCounts[lod], lod, firstInstance, depth);
+            firstInstance += lodInstanceCounts[lod];
         }
-
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // uploads the model matrices of all instances, they are all drawn at full detail
+    void SetInstanceMatrices(const glm::mat4 *matrices, unsigned int amount)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        uploadInstances(matrices, amount);
+        lodInstanceCounts.assign(1, amount);
+    }
 
-        // walk through each of the mesh's vertices
-        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
+    // uploads the model matrices of all instances grouped by the level of detail their distance to viewPosition selects
+    void SetInstanceMatrices(const glm::mat4 *matrices, unsigned int amount, const glm::vec3 &viewPosition)
+    {
+        lodInstanceCounts.assign(lodDistances.size() + 1, 0);
+        instanceLods.resize(amount);
+        for (unsigned int i = 0; i < amount; i++)
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
-            }
-            // texture coordinates
-            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
-            {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
-            }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+            glm::vec3 center = glm::vec3(matrices[i] * glm::vec4(boundingSphere.center, 1.0f));
+            instanceLods[i] = SelectLod(glm::length(center - viewPosition));
+            lodInstanceCounts[instanceLods[i]]++;
+        }
+        // counting sort by level
+        vector<unsigned int> next(lodInstanceCounts.size(), 0);
+        for (unsigned int lod = 1; lod < next.size(); lod++)
+            next[lod] = next[lod - 1] + lodInstanceCounts[lod - 1];
+        sortedInstances.resize(amount);
+        for (unsigned int i = 0; i < amount; i++)
+            sortedInstances[next[instanceLods[i]]++] = matrices[i];
+        uploadInstances(sortedInstances.data(), amount);
+    }
 
-            vertices.push_back(vertex);
+    // frees the buffers of every mesh and the instance buffer, the textures stay with TextureCache
+    void Delete()
+    {
+        for (Mesh& mesh: meshes)
+            mesh.Delete();
+        glDeleteBuffers(1, &instanceVBO);
+        instanceVBO = 0;
+        instanceCapacity = 0;
+    }
 
+    void SetShaderTextureNamePrefix(std::string prefix) {
+        for (Mesh& mesh: meshes) {
+            mesh.glslIdentifierPrefix = prefix;
+            // the sampler names changed, resolve them again on the next draw
+            mesh.boundProgram = 0;
+        }
+    }
+private:
+    TextureLoader *textureLoader;
+    // scratch space for sorting instances by level of detail
+    vector<unsigned int> instanceLods;
+    vector<glm::mat4>    sortedInstances;
 
+    // the buffer only grows so it can be refilled every frame
+    void uploadInstances(const glm::mat4 *matrices, unsigned int amount)
+    {
+        if (instanceVBO == 0)
+        {
+            glGenBuffers(1, &instanceVBO);
+            for (Mesh& mesh: meshes)
+                mesh.SetInstanceBuffer(instanceVBO);
         }
-        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+        GLintptr offset;
+        if (instanceStream && amount > 0 && instanceStream->Write(matrices, amount * sizeof(glm::mat4), 16, offset))
         {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
-            for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+            for (Mesh& mesh: meshes)
+                mesh.SetInstanceSource(instanceStream->buffer, offset);
+            return;
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-        // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
-        // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
-        // Same applies to other texture as the following list summarizes:
-        // diffuse: texture_diffuseN
-        // specular: texture_specularN
-        // normal: texture_normalN
-        aiColor3D color(0.0f, 0.0f, 0.0f);
-        material->Get(AI_MATKEY_COLOR_AMBIENT, color);
-
-
-        // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-        // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-        // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        for (Mesh& mesh: meshes)
+            mesh.SetInstanceSource(instanceVBO, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (amount > instanceCapacity)
+        {
+            glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), matrices, GL_DYNAMIC_DRAW);
+            instanceCapacity = amount;
+        }
+        else if (amount > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, amount * sizeof(glm::mat4), matrices);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // the mounted asset pack or a mesh cache written by an earlier run is used instead when it has the model.
+    void loadModel(string const &path)
     {
-        vector<Texture> textures;
-        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        MeshCache cache;
+        AssetPack::Span cooked;
+        bool packed = AssetPack::Find(path, AssetPack::MESH, cooked);
+        // the model and its material libraries are only read when the pack doesn't have it or is checked against
+        // the loose files, 0 when only the pack has the model
+        uint64_t sourceHash = !packed || AssetPack::ChecksSources() ? MeshCache::SourceHash(path) : 0;
+        if (packed && sourceHash && cooked.sourceHash != sourceHash)
+        {
+            cout << "ASSET_PACK:: " << path << " changed since the pack was cooked, using the file" << endl;
+            packed = false;
+        }
+        if (packed && cache.Parse(cooked.data, cooked.size, cooked.sourceHash))
+            loadCache(cache);
+        else
         {
-            aiString str;
-            mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            // a pack entry that failed to parse was not checked yet
+            if (packed && !sourceHash)
+                sourceHash = MeshCache::SourceHash(path);
+            string cachePath = MeshCache::PathFor(path);
+            if (sourceHash && cache.Open(cachePath, sourceHash))
+                loadCache(cache);
+            else
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                vector<ImportedMesh> imported;
+                if (!MeshImporter::Import(path, imported))
+                    return;
+                if (sourceHash)
+                    MeshCache::Write(cachePath, sourceHash, imported);
+                // the imported vectors move into the meshes, with GPU_ONLY each one is freed right after its upload
+                meshes.reserve(imported.size());
+                for (ImportedMesh &mesh: imported)
                 {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
+                    meshes.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), loadTextures(mesh.textures),
+                                          std::move(mesh.lods), vertexFormat, meshStorage));
+                    meshes.back().aabb = mesh.aabb;
+                    meshes.back().boundingSphere = mesh.boundingSphere;
                 }
             }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory, gammaCorrection);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
         }
-        return textures;
-    }
-};
-
-
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
-{
-    string filename = string(path);
-    filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+        // the model sphere has to enclose the sphere of every mesh
+        for (Mesh& mesh: meshes)
+            aabb.expand(mesh.aabb);
+        boundingSphere.center = aabb.center();
+        for (Mesh& mesh: meshes)
+            boundingSphere.radius = glm::max(boundingSphere.radius,
+                                             glm::length(mesh.boundingSphere.center - boundingSphere.center) + mesh.boundingSphere.radius);
+    }
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    // builds the meshes from an opened cache
+    void loadCache(const MeshCache &cache)
     {
-        GLenum dataFormat;
-        GLenum internalFormat;
-        if (nrComponents == 1)
-            internalFormat = dataFormat = GL_RED;
-        else if (nrComponents == 3) {
-            internalFormat = gamma ? GL_SRGB : GL_RGB;
-            dataFormat = GL_RGB;
-        }
-        else if (nrComponents == 4){
-            internalFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
-            dataFormat = GL_RGBA;
+        meshes.reserve(cache.Meshes().size());
+        for (const MeshCache::MeshView &view: cache.Meshes())
+        {
+            // the vertex and index data goes from the mapping straight into the buffers
+            meshes.push_back(Mesh(view.vertices, view.vertexCount, view.indices, view.indexCount, loadTextures(view.textures), view.lods,
+                                  vertexFormat));
+            meshes.back().aabb = view.aabb;
+            meshes.back().boundingSphere = view.sphere;
         }
+    }
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+    vector<Texture> loadTextures(const vector<TextureReference> &references)
+    {
+        vector<Texture> textures;
+        for (const TextureReference &reference: references)
+            textures.push_back(loadTexture(reference.path.c_str(), reference.type));
+        return textures;
     }
-    else
+
+    // loads the texture at path (relative to the model) unless any model loaded it before
+    Texture loadTexture(const char *path, const string &typeName)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        TextureCache::Handle handle = TextureCache::Load(this->directory + '/' + path, gammaCorrection, TextureLoader::REPEAT,
+                                                         textureLoader);
+        Texture texture;
+        texture.id = handle.Id();
+        texture.type = typeName;
+        texture.path = path;
+        textureHandles.push_back(handle);
+        return texture;
     }
+};
+
 
-    return textureID;
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+{
+    return TextureLoader::LoadNow(directory + '/' + string(path), gamma, TextureLoader::REPEAT);
 }
 #endif
@@ -0,0 +1,256 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/mapped_file.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// ARB_get_program_binary (core in 4.1) is not part of the 3.3 loader, the entry points are looked up at runtime
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC_CACHE)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC_CACHE)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC_CACHE)(GLuint program, GLenum pname, GLint value);
+
+// linked programs kept on disk between runs, so Shader skips compiling and linking once a program was built.
+// A program is stored under a key hashed from its sources and the GL vendor, renderer and version strings, so
+// editing a shader or updating the driver simply misses the cache. Drivers may still refuse a binary they
+// wrote themselves; the file is removed then and the program compiled from source as usual.
+// Files go to <user cache>/learnopengl/programs/<key>.bin: $XDG_CACHE_HOME or ~/.cache, %LOCALAPPDATA% on Windows.
+//
+// Enable once after the context is current, without it Load always misses and Store does nothing.
+class ProgramCache
+{
+public:
+    // load is used to find the program binary entry points, e.g. (GLADloadproc)glfwGetProcAddress.
+    // false when the context can't hand out binaries, directory defaults to the user cache directory.
+    static bool Enable(GLADloadproc load, const std::string &directory = "")
+    {
+        State &state = get();
+        state.enabled = false;
+        if (!HasGLVersion(4, 1) && !HasGLExtension("GL_ARB_get_program_binary"))
+            return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        state.getProgramBinary = (PFNGLGETPROGRAMBINARYPROC_CACHE)load("glGetProgramBinary");
+        state.programBinary = (PFNGLPROGRAMBINARYPROC_CACHE)load("glProgramBinary");
+        state.programParameteri = (PFNGLPROGRAMPARAMETERIPROC_CACHE)load("glProgramParameteri");
+        if (formats <= 0 || !state.getProgramBinary || !state.programBinary || !state.programParameteri)
+            return false;
+        state.directory = directory.empty() ? defaultDirectory() : directory;
+        if (state.directory.empty() || !makeDirectories(state.directory))
+        {
+            std::cout << "ERROR::PROGRAM_CACHE:: no cache directory at " << state.directory << std::endl;
+            return false;
+        }
+        // the same sources give a different binary on another driver. Bump the tag when the file layout changes.
+        uint64_t h = hash("program cache 1", 14695981039346656037ull);
+        for (GLenum name: {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        {
+            const char *value = (const char*)glGetString(name);
+            h = hash(value ? value : "", h);
+        }
+        state.driverHash = h;
+        state.enabled = true;
+        return true;
+    }
+
+    static bool IsEnabled()
+    {
+        return get().enabled;
+    }
+
+    // the key of a program built from these sources (the stages in a fixed order, "" for a missing one)
+    static uint64_t Key(std::initializer_list<const char*> sources)
+    {
+        uint64_t h = get().driverHash;
+        for (const char *source: sources)
+            // the separator keeps "ab" + "c" apart from "a" + "bc"
+            h = hash("\x1f", hash(source ? source : "", h));
+        return h;
+    }
+
+    // links program from the stored binary, false when there is none or the driver rejects it
+    static bool Load(GLuint program, uint64_t key)
+    {
+        State &state = get();
+        if (!state.enabled)
+            return false;
+        std::string path = pathFor(key);
+        MappedFile file;
+        if (!file.Open(path))
+            return false;
+        const Header *header = (const Header*)file.data();
+        if (file.size() < sizeof(Header) || header->magic != MAGIC || header->key != key ||
+            header->length != file.size() - sizeof(Header))
+        {
+            file.Close();
+            std::remove(path.c_str());
+            return false;
+        }
+        state.programBinary(program, header->format, file.data() + sizeof(Header), (GLsizei)header->length);
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked == GL_TRUE)
+            return true;
+        std::cout << "PROGRAM_CACHE:: the driver rejected " << path << ", compiling from source" << std::endl;
+        file.Close();
+        std::remove(path.c_str());
+        return false;
+    }
+
+    // before glLinkProgram, asks the driver to keep the binary around for Store
+    static void Retrievable(GLuint program)
+    {
+        State &state = get();
+        if (state.enabled)
+            state.programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // after glLinkProgram, writes the binary of a successfully linked program
+    static bool Store(GLuint program, uint64_t key)
+    {
+        State &state = get();
+        if (!state.enabled)
+            return false;
+        GLint linked = GL_FALSE, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (linked != GL_TRUE || length <= 0)
+            return false;
+        std::string blob(sizeof(Header) + length, '\0');
+        Header header{MAGIC, 0, key, (uint64_t)length};
+        GLsizei written = 0;
+        state.getProgramBinary(program, length, &written, &header.format, &blob[sizeof(Header)]);
+        if (written != length)
+            return false;
+        std::memcpy(&blob[0], &header, sizeof(Header));
+        // written under another name first so a crash never leaves a half written binary behind
+        std::string path = pathFor(key);
+        std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!out || !out.write(blob.data(), blob.size()))
+            {
+                std::cout << "ERROR::PROGRAM_CACHE:: could not write " << temporaryPath << std::endl;
+                return false;
+            }
+        }
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static const uint32_t MAGIC = 0x474f5250; // "PROG"
+
+    struct Header {
+        uint32_t magic;
+        GLenum format;
+        uint64_t key;
+        uint64_t length;
+    };
+
+    struct State {
+        bool enabled = false;
+        std::string directory;
+        uint64_t driverHash = 0;
+        PFNGLGETPROGRAMBINARYPROC_CACHE getProgramBinary = nullptr;
+        PFNGLPROGRAMBINARYPROC_CACHE programBinary = nullptr;
+        PFNGLPROGRAMPARAMETERIPROC_CACHE programParameteri = nullptr;
+    };
+
+    static State &get()
+    {
+        static State state;
+        return state;
+    }
+
+    // 64 bit FNV-1a, continued from h
+    static uint64_t hash(const char *text, uint64_t h)
+    {
+        for (; *text; text++)
+        {
+            h ^= (unsigned char)*text;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    static std::string pathFor(uint64_t key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return get().directory + '/' + name;
+    }
+
+    static std::string defaultDirectory()
+    {
+#ifdef _WIN32
+        const char *base = std::getenv("LOCALAPPDATA");
+        if (!base)
+            return "";
+        std::string directory = base;
+#else
+        std::string directory;
+        if (const char *cache = std::getenv("XDG_CACHE_HOME"))
+            directory = cache;
+        else if (const char *home = std::getenv("HOME"))
+            directory = std::string(home) + "/.cache";
+        else
+            return "";
+#endif
+        return directory + "/learnopengl/programs";
+    }
+
+    // creates directory and every missing parent
+    static bool makeDirectories(const std::string &directory)
+    {
+        for (size_t i = 1; i <= directory.size(); i++)
+        {
+            if (i < directory.size() && directory[i] != '/' && directory[i] != '\\')
+                continue;
+            std::string prefix = directory.substr(0, i);
+            // "C:" is no directory to create
+            if (prefix.back() == ':')
+                continue;
+#ifdef _WIN32
+            int result = _mkdir(prefix.c_str());
+#else
+            int result = mkdir(prefix.c_str(), 0755);
+#endif
+            if (result != 0 && errno != EEXIST)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,381 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/index_buffer.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// remembers the GL state set through it and drops calls that would not change anything.
+// State changed behind its back (other draw code, imgui) has to be forgotten with Invalidate.
+class GLStateCache
+{
+public:
+    static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+    // number of state changes sent to GL and dropped as redundant since the last Invalidate
+    unsigned int issued = 0;
+    unsigned int skipped = 0;
+
+    void Invalidate()
+    {
+        program = ~0u;
+        vertexArray = ~0u;
+        activeUnit = ~0u;
+        for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+            units[i] = TextureUnit{GL_NONE, ~0u};
+        depthTest = depthWrite = blend = -1;
+        uniformInts.clear();
+        issued = skipped = 0;
+    }
+
+    void UseProgram(GLuint id)
+    {
+        if (changed(program, id))
+            glUseProgram(id);
+    }
+
+    void BindVertexArray(GLuint id)
+    {
+        if (changed(vertexArray, id))
+            glBindVertexArray(id);
+    }
+
+    void BindTexture(unsigned int unit, GLenum target, GLuint id)
+    {
+        if (unit >= MAX_TEXTURE_UNITS)
+        {
+            activeUnit = unit;
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(target, id);
+            issued += 2;
+            return;
+        }
+        TextureUnit &current = units[unit];
+        if (current.target == target && current.id == id)
+        {
+            skipped++;
+            return;
+        }
+        if (changed(activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, id);
+        current = TextureUnit{target, id};
+        issued++;
+    }
+
+    void SetDepthTest(bool enabled)
+    {
+        if (changed(depthTest, enabled))
+            enabled ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+    }
+
+    void SetDepthWrite(bool enabled)
+    {
+        if (changed(depthWrite, enabled))
+            glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+
+    void SetBlend(bool enabled)
+    {
+        if (changed(blend, enabled))
+            enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+    }
+
+    // int, bool and sampler uniforms keep their value per program, so they only have to be set once.
+    // The program has to be in use.
+    void SetUniform(GLuint programId, GLint location, int value)
+    {
+        if (location < 0)
+            return;
+        uint64_t key = (uint64_t(programId) << 32) | uint32_t(location);
+        auto it = uniformInts.find(key);
+        if (it != uniformInts.end() && it->second == value)
+        {
+            skipped++;
+            return;
+        }
+        uniformInts[key] = value;
+        glUniform1i(location, value);
+        issued++;
+    }
+
+private:
+    struct TextureUnit {
+        GLenum target;
+        GLuint id;
+    };
+
+    unsigned int program = ~0u;
+    unsigned int vertexArray = ~0u;
+    unsigned int activeUnit = ~0u;
+    TextureUnit units[MAX_TEXTURE_UNITS];
+    int depthTest = -1, depthWrite = -1, blend = -1;
+    std::unordered_map<uint64_t, int> uniformInts;
+
+    template<typename T, typename U>
+    bool changed(T &current, U value)
+    {
+        if (current == (T)value)
+        {
+            skipped++;
+            return false;
+        }
+        current = (T)value;
+        issued++;
+        return true;
+    }
+};
+
+// everything needed to issue one draw call, collected first and executed in sorted order by RenderQueue
+struct DrawPacket {
+    static const unsigned int MAX_TEXTURES = 4;
+
+    struct TextureBinding {
+        GLuint unit;
+        GLenum target;
+        GLuint id;
+        // sampler uniform pointed at the unit, -1 when the caller sets it itself
+        GLint samplerLocation;
+    };
+
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+    TextureBinding textures[MAX_TEXTURES];
+    unsigned int textureCount = 0;
+
+    GLenum mode = GL_TRIANGLES;
+    // glDrawElements with indices of indexType when set, glDrawArrays otherwise
+    bool indexed = false;
+    GLenum indexType = GL_UNSIGNED_INT;
+    unsigned int first = 0;
+    unsigned int count = 0;
+
+    // drawn with glDrawElementsInstanced when instanceCount > 0, the instance matrices of mesh
+    // are moved to firstInstance first
+    unsigned int instanceCount = 0;
+    unsigned int firstInstance = 0;
+    // set for mesh packets, which also tell the program how to read their vertices
+    Mesh *mesh = nullptr;
+    VertexDecodeUniforms vertexDecode;
+    // bool uniform switching the shader between the model uniform and the instance matrices
+    GLint instancedLocation = -1;
+
+    GLint modelLocation = -1;
+    glm::mat4 model = glm::mat4(1.0f);
+
+    bool depthTest = true;
+    // translucent packets are blended, don't write depth and are drawn after everything else, back to front
+    bool translucent = false;
+    // distance to the viewer, orders opaque packets front to back and translucent ones back to front
+    float depth = 0.0f;
+
+    void AddTexture(GLuint unit, GLenum target, GLuint id, GLint samplerLocation = -1)
+    {
+        if (textureCount < MAX_TEXTURES)
+            textures[textureCount++] = TextureBinding{unit, target, id, samplerLocation};
+    }
+};
+
+// collects the draw packets of a frame, sorts them by a 64 bit key and executes them through a GLStateCache.
+// Opaque packets are grouped by program, then vertex array, then first texture, and front to back inside a group:
+//   63-62 pass | 61-48 program | 47-34 vertex array | 33-20 texture | 19-0 depth
+// Translucent packets have to be drawn back to front, so depth comes first for them:
+//   63-62 pass | 61-40 inverted depth | 39-26 program | 25-12 vertex array | 11-0 texture
+// GL names are cut to the width of their field, two names sharing a field only cost a bind.
+class RenderQueue
+{
+public:
+    GLStateCache state;
+
+    // depth is measured from viewPosition and quantized over [0, farDistance]
+    void Begin(const glm::vec3 &viewPosition, float farDistance)
+    {
+        this->viewPosition = viewPosition;
+        this->farDistance = farDistance;
+        packets.clear();
+    }
+
+    void Submit(const DrawPacket &packet)
+    {
+        packets.push_back(packet);
+    }
+
+    // draws one level of detail of a mesh with a model matrix, depth is taken from its bounding sphere
+    void SubmitMesh(Mesh &mesh, Shader &shader, const glm::mat4 &model, unsigned int lod = 0)
+    {
+        DrawPacket packet = meshPacket(mesh, shader, lod);
+        packet.modelLocation = shader.getUniform<glm::mat4>(UNIFORM("model")).location;
+        packet.model = model;
+        packet.instancedLocation = shader.getUniform<bool>(UNIFORM("instanced")).location;
+        packet.depth = glm::length(glm::vec3(model * glm::vec4(mesh.boundingSphere.center, 1.0f)) - viewPosition);
+        packets.push_back(packet);
+    }
+
+    // draws amount instances of the mesh from its instance buffer, starting at firstInstance
+    void SubmitMeshInstanced(Mesh &mesh, Shader &shader, unsigned int amount, unsigned int lod = 0,
+                             unsigned int firstInstance = 0, float depth = 0.0f)
+    {
+        if (amount == 0)
+            return;
+        DrawPacket packet = meshPacket(mesh, shader, lod);
+        packet.instanceCount = amount;
+        packet.firstInstance = firstInstance;
+        packet.instancedLocation = shader.getUniform<bool>(UNIFORM("instanced")).location;
+        packet.depth = depth;
+        packets.push_back(packet);
+    }
+
+    // sorts and draws everything submitted since Begin
+    void Flush()
+    {
+        // other code may have touched anything since the last frame
+        state.Invalidate();
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        sortPackets();
+        for (const SortEntry &entry: sorted)
+            execute(packets[entry.packet]);
+
+        // leave the defaults the rest of the code expects
+        state.SetBlend(false);
+        state.SetDepthWrite(true);
+        state.SetDepthTest(true);
+        state.BindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        packets.clear();
+    }
+
+    uint64_t SortKey(const DrawPacket &packet) const
+    {
+        const unsigned int DEPTH_BITS_OPAQUE = 20, DEPTH_BITS_TRANSLUCENT = 22;
+        float normalized = glm::clamp(packet.depth / farDistance, 0.0f, 1.0f);
+        GLuint texture = packet.textureCount > 0 ? packet.textures[0].id : 0;
+        if (!packet.translucent)
+        {
+            uint64_t depth = uint64_t(normalized * ((1u << DEPTH_BITS_OPAQUE) - 1));
+            return (uint64_t(0) << 62) |
+                   (uint64_t(packet.program & 0x3fff) << 48) |
+                   (uint64_t(packet.vertexArray & 0x3fff) << 34) |
+                   (uint64_t(texture & 0x3fff) << 20) |
+                   depth;
+        }
+        uint64_t depth = uint64_t((1.0f - normalized) * ((1u << DEPTH_BITS_TRANSLUCENT) - 1));
+        return (uint64_t(1) << 62) |
+               (depth << 40) |
+               (uint64_t(packet.program & 0x3fff) << 26) |
+               (uint64_t(packet.vertexArray & 0x3fff) << 12) |
+               uint64_t(texture & 0xfff);
+    }
+
+    unsigned int size() const
+    {
+        return packets.size();
+    }
+
+private:
+    struct SortEntry {
+        uint64_t key;
+        unsigned int packet;
+    };
+
+    glm::vec3 viewPosition = glm::vec3(0.0f);
+    float farDistance = 1.0f;
+    std::vector<DrawPacket> packets;
+    // sort scratch space, kept around so a frame does not allocate
+    std::vector<SortEntry> sorted;
+    std::vector<SortEntry> scratch;
+
+    DrawPacket meshPacket(Mesh &mesh, Shader &shader, unsigned int lod)
+    {
+        DrawPacket packet;
+        packet.program = shader.ID;
+        packet.vertexArray = mesh.VAO;
+        // the samplers of the program are set once by BindShader, the packet only binds
+        if (mesh.boundProgram != shader.ID)
+            mesh.BindShader(shader);
+        for (const SamplerBinding &binding: mesh.samplerBindings)
+            packet.AddTexture(binding.unit, GL_TEXTURE_2D, binding.texture);
+        packet.mesh = &mesh;
+        packet.vertexDecode = mesh.vertexDecodeUniforms;
+        const MeshLod &level = mesh.lods[lod < mesh.lods.size() ? lod : mesh.lods.size() - 1];
+        packet.indexed = true;
+        packet.indexType = mesh.indexType;
+        packet.first = level.firstIndex;
+        packet.count = level.indexCount;
+        return packet;
+    }
+
+    // least significant digit radix sort over bytes, passes where every key has the same byte are skipped
+    void sortPackets()
+    {
+        unsigned int count = packets.size();
+        sorted.resize(count);
+        scratch.resize(count);
+        for (unsigned int i = 0; i < count; i++)
+            sorted[i] = SortEntry{SortKey(packets[i]), i};
+
+        for (unsigned int shift = 0; shift < 64; shift += 8)
+        {
+            unsigned int histogram[256];
+            std::memset(histogram, 0, sizeof(histogram));
+            for (unsigned int i = 0; i < count; i++)
+                histogram[(sorted[i].key >> shift) & 0xff]++;
+            if (count == 0 || histogram[(sorted[0].key >> shift) & 0xff] == count)
+                continue;
+            unsigned int offset = 0;
+            for (unsigned int digit = 0; digit < 256; digit++)
+            {
+                unsigned int digitCount = histogram[digit];
+                histogram[digit] = offset;
+                offset += digitCount;
+            }
+            for (unsigned int i = 0; i < count; i++)
+                scratch[histogram[(sorted[i].key >> shift) & 0xff]++] = sorted[i];
+            sorted.swap(scratch);
+        }
+    }
+
+    void execute(const DrawPacket &packet)
+    {
+        state.SetDepthTest(packet.depthTest);
+        state.SetDepthWrite(!packet.translucent);
+        state.SetBlend(packet.translucent);
+
+        state.UseProgram(packet.program);
+        state.BindVertexArray(packet.vertexArray);
+        for (unsigned int i = 0; i < packet.textureCount; i++)
+        {
+            const DrawPacket::TextureBinding &binding = packet.textures[i];
+            state.BindTexture(binding.unit, binding.target, binding.id);
+            state.SetUniform(packet.program, binding.samplerLocation, binding.unit);
+        }
+        state.SetUniform(packet.program, packet.instancedLocation, packet.instanceCount > 0);
+        if (packet.mesh)
+            packet.mesh->SetVertexDecode(packet.vertexDecode);
+
+        if (packet.instanceCount > 0)
+        {
+            if (packet.mesh)
+                packet.mesh->SetFirstInstance(packet.firstInstance);
+            glDrawElementsInstanced(packet.mode, packet.count, packet.indexType,
+                                    IndexBuffer::Offset(packet.indexType, packet.first), packet.instanceCount);
+            return;
+        }
+        if (packet.modelLocation >= 0)
+            glUniformMatrix4fv(packet.modelLocation, 1, GL_FALSE, &packet.model[0][0]);
+        if (packet.indexed)
+            glDrawElements(packet.mode, packet.count, packet.indexType, IndexBuffer::Offset(packet.indexType, packet.first));
+        else
+            glDrawArrays(packet.mode, packet.first, packet.count);
+    }
+};
+
+#endif
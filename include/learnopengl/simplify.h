@@ -0,0 +1,305 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// mesh simplification with quadric error metrics (Garland & Heckbert).
+// Edges are collapsed onto one of their existing endpoints, so every level of detail indexes
+// the same vertex buffer and only needs its own index range.
+// Vertices on texture seams (same position, several vertices) are never removed, and open
+// borders are kept in place by extra planes perpendicular to the border edges.
+class MeshSimplifier
+{
+public:
+    // returns a new index list with at most targetIndexCount indices (or as close as collapses allow)
+    static vector<unsigned int> Simplify(const vector<Vertex> &vertices, const vector<unsigned int> &indices, size_t targetIndexCount)
+    {
+        MeshSimplifier simplifier(vertices, indices);
+        return simplifier.run(targetIndexCount);
+    }
+
+private:
+    // symmetric 4x4 matrix stored as its upper triangle
+    struct Quadric {
+        double a[10] = {0.0};
+
+        void addPlane(const glm::vec3 &n, float d, double weight)
+        {
+            double p[4] = {n.x, n.y, n.z, d};
+            int k = 0;
+            for (int i = 0; i < 4; i++)
+                for (int j = i; j < 4; j++)
+                    a[k++] += weight * p[i] * p[j];
+        }
+
+        void add(const Quadric &other)
+        {
+            for (int i = 0; i < 10; i++)
+                a[i] += other.a[i];
+        }
+
+        double evaluate(const glm::vec3 &v) const
+        {
+            double x = v.x, y = v.y, z = v.z;
+            return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+                 + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+                 + a[7] * z * z + 2 * a[8] * z
+                 + a[9];
+        }
+    };
+
+    struct Collapse {
+        double cost;
+        unsigned int from, to;
+        unsigned int fromVersion, toVersion;
+
+        bool operator<(const Collapse &other) const
+        {
+            // std::priority_queue is a max heap, the cheapest collapse has to come out first
+            return cost > other.cost;
+        }
+    };
+
+    // border planes get a large weight so open edges (leaf cards, holes) keep their outline
+    static constexpr double BORDER_WEIGHT = 10.0;
+
+    const vector<Vertex> &vertices;
+    // triangles as vertex indices, removed ones are marked dead
+    vector<unsigned int> triangles;
+    vector<bool> triangleAlive;
+    unsigned int liveTriangles;
+    // vertices welded by position, the simplification works on these positions
+    vector<unsigned int> positionOf;
+    vector<glm::vec3> positions;
+    vector<unsigned int> wedgeCount;
+    vector<Quadric> quadrics;
+    vector<vector<unsigned int>> trianglesOfPosition;
+    vector<unsigned int> version;
+    vector<bool> removed;
+    std::priority_queue<Collapse> queue;
+
+    MeshSimplifier(const vector<Vertex> &vertices, const vector<unsigned int> &indices)
+        : vertices(vertices), triangles(indices), triangleAlive(indices.size() / 3, true), liveTriangles(indices.size() / 3)
+    {
+        triangles.resize(liveTriangles * 3);
+        weldPositions();
+        computeQuadrics();
+    }
+
+    static uint64_t edgeKey(unsigned int a, unsigned int b)
+    {
+        if (a > b)
+            std::swap(a, b);
+        return (uint64_t(a) << 32) | b;
+    }
+
+    void weldPositions()
+    {
+        struct PositionHash {
+            size_t operator()(const glm::vec3 &p) const
+            {
+                uint32_t h[3];
+                std::memcpy(h, &p, sizeof(h));
+                return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+            }
+        };
+        struct PositionEqual {
+            bool operator()(const glm::vec3 &a, const glm::vec3 &b) const
+            {
+                return a.x == b.x && a.y == b.y && a.z == b.z;
+            }
+        };
+        std::unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> lookup;
+        lookup.reserve(vertices.size());
+        positionOf.resize(vertices.size());
+        for (unsigned int i = 0; i < vertices.size(); i++)
+        {
+            auto inserted = lookup.insert(std::make_pair(vertices[i].Position, (unsigned int)positions.size()));
+            if (inserted.second)
+            {
+                positions.push_back(vertices[i].Position);
+                wedgeCount.push_back(0);
+            }
+            positionOf[i] = inserted.first->second;
+            wedgeCount[positionOf[i]]++;
+        }
+        quadrics.resize(positions.size());
+        trianglesOfPosition.resize(positions.size());
+        version.assign(positions.size(), 0);
+        removed.assign(positions.size(), false);
+    }
+
+    void computeQuadrics()
+    {
+        std::unordered_map<uint64_t, int> edgeUse;
+        for (unsigned int t = 0; t < triangleAlive.size(); t++)
+        {
+            unsigned int p[3] = {positionOf[triangles[3 * t]], positionOf[triangles[3 * t + 1]], positionOf[triangles[3 * t + 2]]};
+            glm::vec3 normal = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+            float area = glm::length(normal);
+            for (int k = 0; k < 3; k++)
+            {
+                trianglesOfPosition[p[k]].push_back(t);
+                edgeUse[edgeKey(p[k], p[(k + 1) % 3])]++;
+            }
+            if (area <= 0.0f)
+                continue;
+            normal /= area;
+            for (int k = 0; k < 3; k++)
+                quadrics[p[k]].addPlane(normal, -glm::dot(normal, positions[p[0]]), area * 0.5);
+        }
+
+        for (unsigned int t = 0; t < triangleAlive.size(); t++)
+        {
+            unsigned int p[3] = {positionOf[triangles[3 * t]], positionOf[triangles[3 * t + 1]], positionOf[triangles[3 * t + 2]]};
+            glm::vec3 normal = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+            if (glm::length(normal) <= 0.0f)
+                continue;
+            normal = glm::normalize(normal);
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = p[k], b = p[(k + 1) % 3];
+                if (edgeUse[edgeKey(a, b)] != 1)
+                    continue;
+                glm::vec3 edge = positions[b] - positions[a];
+                float length = glm::length(edge);
+                if (length <= 0.0f)
+                    continue;
+                glm::vec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+                float d = -glm::dot(borderNormal, positions[a]);
+                quadrics[a].addPlane(borderNormal, d, BORDER_WEIGHT * length * length);
+                quadrics[b].addPlane(borderNormal, d, BORDER_WEIGHT * length * length);
+            }
+        }
+
+        for (auto &entry: edgeUse)
+            pushEdge(unsigned(entry.first >> 32), unsigned(entry.first & 0xffffffffu));
+    }
+
+    // queues the cheaper of the two directions of an edge
+    void pushEdge(unsigned int a, unsigned int b)
+    {
+        if (a == b)
+            return;
+        Quadric q = quadrics[a];
+        q.add(quadrics[b]);
+        double costAB = wedgeCount[a] == 1 ? q.evaluate(positions[b]) : DBL_MAX;
+        double costBA = wedgeCount[b] == 1 ? q.evaluate(positions[a]) : DBL_MAX;
+        if (costAB == DBL_MAX && costBA == DBL_MAX)
+            return;
+        if (costAB <= costBA)
+            queue.push(Collapse{costAB, a, b, version[a], version[b]});
+        else
+            queue.push(Collapse{costBA, b, a, version[b], version[a]});
+    }
+
+    // moving from onto to must not turn any remaining triangle around
+    bool flipsTriangle(unsigned int from, unsigned int to) const
+    {
+        for (unsigned int t: trianglesOfPosition[from])
+        {
+            if (!triangleAlive[t])
+                continue;
+            glm::vec3 p[3];
+            bool containsTo = false;
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int position = positionOf[triangles[3 * t + k]];
+                containsTo = containsTo || position == to;
+                p[k] = positions[position];
+            }
+            if (containsTo)
+                continue;
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            for (int k = 0; k < 3; k++)
+                if (positionOf[triangles[3 * t + k]] == from)
+                    p[k] = positions[to];
+            glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+            if (glm::dot(before, after) <= 0.0f)
+                return true;
+        }
+        return false;
+    }
+
+    vector<unsigned int> run(size_t targetIndexCount)
+    {
+        while (liveTriangles * 3 > targetIndexCount && !queue.empty())
+        {
+            Collapse collapse = queue.top();
+            queue.pop();
+            if (removed[collapse.from] || removed[collapse.to] ||
+                version[collapse.from] != collapse.fromVersion || version[collapse.to] != collapse.toVersion)
+                continue;
+            if (flipsTriangle(collapse.from, collapse.to))
+                continue;
+
+            // the vertex of the target position that the triangles on this side of it use
+            unsigned int targetVertex = ~0u;
+            for (unsigned int t: trianglesOfPosition[collapse.from])
+            {
+                if (!triangleAlive[t])
+                    continue;
+                for (int k = 0; k < 3; k++)
+                    if (positionOf[triangles[3 * t + k]] == collapse.to)
+                        targetVertex = triangles[3 * t + k];
+                if (targetVertex != ~0u)
+                    break;
+            }
+            if (targetVertex == ~0u)
+                continue;
+
+            for (unsigned int t: trianglesOfPosition[collapse.from])
+            {
+                if (!triangleAlive[t])
+                    continue;
+                bool degenerate = false;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int position = positionOf[triangles[3 * t + k]];
+                    if (position == collapse.to)
+                        degenerate = true;
+                    else if (position == collapse.from)
+                        triangles[3 * t + k] = targetVertex;
+                }
+                if (degenerate)
+                {
+                    triangleAlive[t] = false;
+                    liveTriangles--;
+                }
+                else
+                    trianglesOfPosition[collapse.to].push_back(t);
+            }
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            removed[collapse.from] = true;
+            trianglesOfPosition[collapse.from].clear();
+            version[collapse.to]++;
+
+            // the costs of every edge around the merged vertex changed
+            for (unsigned int t: trianglesOfPosition[collapse.to])
+            {
+                if (!triangleAlive[t])
+                    continue;
+                for (int k = 0; k < 3; k++)
+                    pushEdge(collapse.to, positionOf[triangles[3 * t + k]]);
+            }
+        }
+
+        vector<unsigned int> result;
+        result.reserve(liveTriangles * 3);
+        for (unsigned int t = 0; t < triangleAlive.size(); t++)
+            if (triangleAlive[t])
+                result.insert(result.end(), triangles.begin() + 3 * t, triangles.begin() + 3 * t + 3);
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/index_buffer.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// geometry that never moves, baked into one vertex and index buffer at startup and drawn with static_batch.vs.
+// Every vertex carries the index of the draw it belongs to; the vertex shader fetches that draw's model matrix,
+// normal matrix and material from a buffer texture, so no uniform changes between draws.
+// Draws are grouped by texture and every group is one contiguous index range, i.e. one draw call.
+class StaticBatch
+{
+public:
+    // vertices are interleaved position (3), normal (3) and texture coordinates (2), like the quads in main.cpp.
+    // texture is a GL_TEXTURE_2D, or a GL_TEXTURE_2D_ARRAY when materialLayer is not negative; uvScale maps the
+    // texture coordinates onto the part of the layer the image covers (see loadTextureArray in main.cpp).
+    void Add(const float *vertices, unsigned int vertexCount, const glm::mat4 &model, unsigned int texture,
+             int materialLayer = -1, const glm::vec2 &uvScale = glm::vec2(1.0f))
+    {
+        Draw draw;
+        draw.model = model;
+        draw.texture = texture;
+        draw.materialLayer = materialLayer;
+        draw.uvScale = uvScale;
+        draw.vertices.assign(vertices, vertices + vertexCount * FLOATS_PER_VERTEX);
+        draws.push_back(draw);
+    }
+
+    // uploads everything added so far, the CPU copies are dropped afterwards
+    void Build()
+    {
+        // stable so that draws with the same texture keep the order they were added in
+        std::stable_sort(draws.begin(), draws.end(), [](const Draw &a, const Draw &b) { return a.texture < b.texture; });
+
+        std::vector<BatchVertex> vertices;
+        std::vector<unsigned int> indices;
+        // per draw: model matrix (4 texels), normal matrix (3 texels), material (1 texel)
+        std::vector<glm::vec4> drawData;
+        groups.clear();
+        for (unsigned int d = 0; d < draws.size(); d++)
+        {
+            const Draw &draw = draws[d];
+            if (groups.empty() || groups.back().texture != draw.texture)
+                groups.push_back(Group{draw.texture, draw.materialLayer >= 0, (unsigned int)indices.size(), 0});
+            unsigned int vertexCount = draw.vertices.size() / FLOATS_PER_VERTEX;
+            unsigned int firstVertex = vertices.size();
+            for (unsigned int v = 0; v < vertexCount; v++)
+            {
+                const float *source = &draw.vertices[v * FLOATS_PER_VERTEX];
+                BatchVertex vertex;
+                vertex.position = glm::vec3(source[0], source[1], source[2]);
+                vertex.normal = glm::vec3(source[3], source[4], source[5]);
+                vertex.texCoords = glm::vec2(source[6], source[7]);
+                vertex.drawIndex = d;
+                vertices.push_back(vertex);
+                indices.push_back(firstVertex + v);
+            }
+            groups.back().indexCount += vertexCount;
+
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(draw.model)));
+            for (unsigned int c = 0; c < 4; c++)
+                drawData.push_back(draw.model[c]);
+            for (unsigned int c = 0; c < 3; c++)
+                drawData.push_back(glm::vec4(normalMatrix[c], 0.0f));
+            drawData.push_back(glm::vec4((float)draw.materialLayer, draw.uvScale, 0.0f));
+        }
+        draws.clear();
+        draws.shrink_to_fit();
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(BatchVertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        indexType = IndexBuffer::TypeFor(vertices.size());
+        IndexBuffer::Upload(indices.data(), indices.size(), indexType);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, texCoords));
+        // integer attribute, see aDrawIndex in static_batch.vs
+        glEnableVertexAttribArray(3);
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(BatchVertex), (void*)offsetof(BatchVertex, drawIndex));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glGenBuffers(1, &drawBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, drawBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, drawData.size() * sizeof(glm::vec4), drawData.data(), GL_STATIC_DRAW);
+        glGenTextures(1, &drawTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, drawTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, drawBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // queues one packet per texture group, shader is expected to be static_batch.vs with omnishader.fs
+    void Submit(RenderQueue &queue, Shader &shader) const
+    {
+        GLint drawUnit = shader.samplerUnit(UNIFORM("draws"));
+        GLint diffuseUnit = shader.samplerUnit(UNIFORM("material.texture_diffuse1"));
+        GLint layeredUnit = shader.samplerUnit(UNIFORM("layeredDiffuse"));
+        for (const Group &group: groups)
+        {
+            DrawPacket packet;
+            packet.program = shader.ID;
+            packet.vertexArray = VAO;
+            // the samplers are set to their units when the program is linked
+            if (drawUnit >= 0)
+                packet.AddTexture(drawUnit, GL_TEXTURE_BUFFER, drawTexture);
+            if (group.layered && layeredUnit >= 0)
+                packet.AddTexture(layeredUnit, GL_TEXTURE_2D_ARRAY, group.texture);
+            else if (!group.layered && diffuseUnit >= 0)
+                packet.AddTexture(diffuseUnit, GL_TEXTURE_2D, group.texture);
+            packet.indexed = true;
+            packet.indexType = indexType;
+            packet.first = group.firstIndex;
+            packet.count = group.indexCount;
+            queue.Submit(packet);
+        }
+    }
+
+    unsigned int GroupCount() const
+    {
+        return groups.size();
+    }
+
+    void Delete()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        glDeleteBuffers(1, &drawBuffer);
+        glDeleteTextures(1, &drawTexture);
+    }
+
+private:
+    static const unsigned int FLOATS_PER_VERTEX = 8;
+
+    struct Draw {
+        glm::mat4 model;
+        unsigned int texture;
+        int materialLayer;
+        glm::vec2 uvScale;
+        std::vector<float> vertices;
+    };
+
+    struct BatchVertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 texCoords;
+        unsigned int drawIndex;
+    };
+
+    // draws sharing a texture (all layers of an array), one draw call
+    struct Group {
+        unsigned int texture;
+        bool layered;
+        unsigned int firstIndex;
+        unsigned int indexCount;
+    };
+
+    std::vector<Draw> draws;
+    std::vector<Group> groups;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    unsigned int drawBuffer = 0, drawTexture = 0;
+};
+
+#endif
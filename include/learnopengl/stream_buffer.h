@@ -0,0 +1,203 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+// ARB_buffer_storage (core in 4.4) is not part of the 3.3 loader, the entry point is looked up at runtime
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC_STREAM)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+// ring buffer for data written once per frame (instance matrices, uniform blocks).
+// The buffer is split into one region per frame in flight. With ARB_buffer_storage it stays mapped for its
+// whole life and a fence per region makes sure the GPU is done with a region before it is written again.
+// Without it every frame orphans the buffer and maps it unsynchronized, the driver then hands out fresh
+// storage instead of waiting. Either way nothing written through Allocate makes the driver stall.
+//
+// Per frame: BeginFrame, any number of Allocate, Commit before the first draw that reads the data, EndFrame
+// after the last one.
+class StreamBuffer
+{
+public:
+    struct Allocation {
+        // nullptr when the frame's region is full, the caller has to upload the data some other way
+        void *data;
+        // byte offset of data in buffer
+        GLintptr offset;
+    };
+
+    unsigned int buffer = 0;
+
+    // load is used to find glBufferStorage, e.g. (GLADloadproc)glfwGetProcAddress
+    void Create(GLADloadproc load, GLsizeiptr regionSize, unsigned int framesInFlight = 3)
+    {
+        this->regionSize = regionSize;
+        this->framesInFlight = framesInFlight < MAX_FRAMES_IN_FLIGHT ? framesInFlight : MAX_FRAMES_IN_FLIGHT;
+        PFNGLBUFFERSTORAGEPROC_STREAM bufferStorage = nullptr;
+        if (hasBufferStorage())
+            bufferStorage = (PFNGLBUFFERSTORAGEPROC_STREAM)load("glBufferStorage");
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        persistent = bufferStorage != nullptr;
+        if (persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorage(GL_ARRAY_BUFFER, regionSize * this->framesInFlight, NULL, flags);
+            mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * this->framesInFlight, flags);
+            if (!mapped)
+            {
+                std::cout << "ERROR::STREAM_BUFFER:: persistent mapping failed, orphaning instead" << std::endl;
+                // immutable storage can't be respecified, start over with a mutable buffer
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                glDeleteBuffers(1, &buffer);
+                glGenBuffers(1, &buffer);
+                glBindBuffer(GL_ARRAY_BUFFER, buffer);
+                persistent = false;
+            }
+        }
+        if (!persistent)
+        {
+            // a single region is enough, orphaning gives every frame its own storage
+            this->framesInFlight = 1;
+            glBufferData(GL_ARRAY_BUFFER, regionSize, NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        region = 0;
+    }
+
+    // waits until the GPU is done with the region of this frame (normally it already is)
+    void BeginFrame()
+    {
+        used = 0;
+        if (persistent)
+        {
+            region = (region + 1) % framesInFlight;
+            waitForRegion(region);
+            frameData = mapped + region * regionSize;
+        }
+        else
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(GL_ARRAY_BUFFER, regionSize, NULL, GL_STREAM_DRAW);
+            frameData = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize,
+                                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    }
+
+    // alignment has to be a power of two
+    Allocation Allocate(GLsizeiptr size, GLsizeiptr alignment = 16)
+    {
+        GLsizeiptr start = (used + alignment - 1) & ~(alignment - 1);
+        if (!frameData || start + size > regionSize)
+            return Allocation{nullptr, 0};
+        used = start + size;
+        return Allocation{frameData + start, GLintptr(region * regionSize + start)};
+    }
+
+    // copies data into the buffer, returns false when it didn't fit
+    bool Write(const void *data, GLsizeiptr size, GLsizeiptr alignment, GLintptr &offset)
+    {
+        Allocation allocation = Allocate(size, alignment);
+        if (!allocation.data)
+            return false;
+        std::memcpy(allocation.data, data, size);
+        offset = allocation.offset;
+        return true;
+    }
+
+    // makes the writes of this frame visible to GL, no more allocations until the next BeginFrame
+    void Commit()
+    {
+        if (!persistent && frameData)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        // coherent mappings need no flush
+        frameData = nullptr;
+    }
+
+    // call after the last draw that reads this frame's data
+    void EndFrame()
+    {
+        if (!persistent)
+            return;
+        if (fences[region])
+            glDeleteSync(fences[region]);
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    bool IsPersistent() const
+    {
+        return persistent;
+    }
+
+    void Delete()
+    {
+        for (unsigned int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            if (fences[i])
+                glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+        if (persistent)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+
+private:
+    static const unsigned int MAX_FRAMES_IN_FLIGHT = 4;
+
+    GLsizeiptr regionSize = 0;
+    unsigned int framesInFlight = 1;
+    unsigned int region = 0;
+    bool persistent = false;
+    unsigned char *mapped = nullptr;
+    unsigned char *frameData = nullptr;
+    GLsizeiptr used = 0;
+    GLsync fences[MAX_FRAMES_IN_FLIGHT] = {};
+
+    static bool hasBufferStorage()
+    {
+        return HasGLVersion(4, 4) || HasGLExtension("GL_ARB_buffer_storage");
+    }
+
+    void waitForRegion(unsigned int index)
+    {
+        if (!fences[index])
+            return;
+        while (true)
+        {
+            // the flush makes sure the fence actually gets to the GPU
+            GLenum result = glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+                break;
+            if (result == GL_WAIT_FAILED)
+            {
+                std::cout << "ERROR::STREAM_BUFFER:: waiting for the GPU failed" << std::endl;
+                break;
+            }
+        }
+        glDeleteSync(fences[index]);
+        fences[index] = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/texture_loader.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// one GL texture per image and sampling parameters for the whole process, however many models or scenes ask
+// for it. Textures are keyed by their canonical path (relative to the project root, "." and ".." resolved) plus
+// gamma and wrap, and handed out as counted Handles. When the last handle of a texture goes away the texture is
+// queued for deletion, Collect deletes the queued ones. Everything here runs on the GL thread.
+class TextureCache
+{
+private:
+    struct Entry {
+        unsigned int texture;
+        // by Clear, while handles were still around
+        bool deleted;
+    };
+
+public:
+    // keeps a cached texture alive, copies share it
+    class Handle
+    {
+    public:
+        Handle() = default;
+
+        unsigned int Id() const
+        {
+            return entry && !entry->deleted ? entry->texture : 0;
+        }
+
+        explicit operator bool() const
+        {
+            return entry != nullptr;
+        }
+
+    private:
+        friend class TextureCache;
+        std::shared_ptr<Entry> entry;
+
+        explicit Handle(std::shared_ptr<Entry> entry) : entry(std::move(entry))
+        {
+        }
+    };
+
+    // the cached texture, or a new one queued on loader (decoded right away without one)
+    static Handle Load(const std::string &path, bool gamma, TextureLoader::Wrap wrap, TextureLoader *loader = nullptr)
+    {
+        State &state = get();
+        std::string key = Key(path, gamma, wrap);
+        auto found = state.entries.find(key);
+        if (found != state.entries.end())
+        {
+            if (std::shared_ptr<Entry> entry = found->second.lock())
+                return Handle(entry);
+        }
+        unsigned int texture = loader ? loader->Load(path, gamma, wrap) : TextureLoader::LoadNow(path, gamma, wrap);
+        std::shared_ptr<Entry> entry(new Entry{texture, false}, release);
+        state.entries[key] = entry;
+        return Handle(entry);
+    }
+
+    // deletes the textures without handles. Textures still queued on a TextureLoader must have been uploaded
+    // (Finish or Update) before.
+    static void Collect()
+    {
+        State &state = get();
+        if (state.released.empty())
+            return;
+        glDeleteTextures(state.released.size(), state.released.data());
+        state.released.clear();
+        for (auto it = state.entries.begin(); it != state.entries.end();)
+        {
+            if (it->second.expired())
+                it = state.entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    // deletes every texture, handles still around return 0 from then on. For shutdown, while the context
+    // still exists.
+    static void Clear()
+    {
+        State &state = get();
+        for (auto &entry: state.entries)
+        {
+            if (std::shared_ptr<Entry> live = entry.second.lock())
+            {
+                state.released.push_back(live->texture);
+                live->deleted = true;
+            }
+        }
+        state.entries.clear();
+        glDeleteTextures(state.released.size(), state.released.data());
+        state.released.clear();
+    }
+
+    // textures with at least one handle
+    static size_t Count()
+    {
+        size_t count = 0;
+        for (auto &entry: get().entries)
+            count += entry.second.expired() ? 0 : 1;
+        return count;
+    }
+
+    // what two loads of the same texture have in common
+    static std::string Key(const std::string &path, bool gamma, TextureLoader::Wrap wrap)
+    {
+        std::string key = Canonical(path);
+        key += '\n';
+        key += gamma ? 's' : 'l';
+        key += char('0' + wrap);
+        return key;
+    }
+
+    // AssetPack::Normalize with "." and ".." segments taken out, so every way of writing a path ends up the same
+    static std::string Canonical(const std::string &path)
+    {
+        std::string normalized = AssetPack::Normalize(path);
+        std::vector<std::string> segments;
+        size_t start = 0;
+        while (start <= normalized.size())
+        {
+            size_t end = normalized.find('/', start);
+            if (end == std::string::npos)
+                end = normalized.size();
+            std::string segment = normalized.substr(start, end - start);
+            if (segment == ".." && !segments.empty() && segments.back() != ".." && !segments.back().empty())
+                segments.pop_back();
+            else if (segment != "." && !(segment.empty() && !segments.empty()))
+                segments.push_back(segment);
+            start = end + 1;
+        }
+        std::string canonical;
+        for (size_t i = 0; i < segments.size(); i++)
+        {
+            if (i > 0)
+                canonical += '/';
+            canonical += segments[i];
+        }
+        return canonical;
+    }
+
+private:
+    struct State {
+        std::unordered_map<std::string, std::weak_ptr<Entry>> entries;
+        // textures whose last handle is gone
+        std::vector<GLuint> released;
+    };
+
+    static State &get()
+    {
+        static State state;
+        return state;
+    }
+
+    static void release(Entry *entry)
+    {
+        if (!entry->deleted)
+            get().released.push_back(entry->texture);
+        delete entry;
+    }
+};
+
+#endif
@@ -0,0 +1,404 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/cooked_texture.h>
+#include <learnopengl/image_decoder.h>
+#include <learnopengl/mip_generator.h>
+#include <learnopengl/texture_uploader.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// loads textures with the image decoding spread over a thread pool.
+// Load and LoadArray hand out the texture name right away and queue the decode, for Load along with the mip
+// chain so the GL thread doesn't run glGenerateMipmap; Finish waits for the workers and does the uploads, which
+// have to happen on the thread that owns the context. Queue everything, do other startup work (shaders, models),
+// then call Finish before the textures are drawn.
+// With an uploader the pixels go through its staging buffer; loose images are decoded by the workers right into
+// a mapped pixel buffer, so they are never copied on the CPU. Textures queued while the scene runs are picked
+// up by Update once decoded, a texture is left for the next frame instead of waiting for staging memory.
+class TextureLoader
+{
+public:
+    enum Wrap {
+        REPEAT,
+        // clamped when the image has an alpha channel, repeated otherwise
+        CLAMP_IF_ALPHA,
+        CLAMP
+    };
+
+    explicit TextureLoader(TextureUploader *uploader = nullptr, unsigned int threadCount = 0)
+        : uploader(uploader), pool(threadCount)
+    {
+    }
+
+    unsigned int Load(const std::string &path, bool gamma, Wrap wrap = REPEAT)
+    {
+        Request &request = queue(GL_TEXTURE_2D, gamma, wrap, 1);
+        request.images[0].path = path;
+        if (uploader)
+            reserveDirect(request.images[0]);
+        Request *pending = &request;
+        Image *image = &request.images[0];
+        pool.Enqueue([pending, image, gamma] { prepare(*image, false, gamma); pending->remaining--; });
+        return request.texture;
+    }
+
+    // all images become layers of one GL_TEXTURE_2D_ARRAY, see uploadArray. uvScales is filled in by Finish.
+    unsigned int LoadArray(const std::vector<std::string> &paths, bool gamma, std::vector<glm::vec2> &uvScales)
+    {
+        Request &request = queue(GL_TEXTURE_2D_ARRAY, gamma, CLAMP, paths.size());
+        request.uvScales = &uvScales;
+        for (unsigned int i = 0; i < paths.size(); i++)
+        {
+            request.images[i].path = paths[i];
+            Request *pending = &request;
+            Image *image = &request.images[i];
+            pool.Enqueue([pending, image, gamma] { prepare(*image, true, gamma); pending->remaining--; });
+        }
+        return request.texture;
+    }
+
+    // waits for the decodes queued so far and uploads them, on the GL thread
+    void Finish()
+    {
+        pool.Wait();
+        for (Request &request: requests)
+        {
+            if (!request.uploaded)
+                uploadRequest(request, true);
+        }
+        requests.clear();
+    }
+
+    // per frame: uploads the textures whose decodes are done, without ever waiting for the workers or the GPU
+    void Update()
+    {
+        for (Request &request: requests)
+        {
+            if (request.uploaded || request.remaining != 0)
+                continue;
+            // staging is full, the rest goes next frame
+            if (!uploadRequest(request, false))
+                break;
+        }
+        while (!requests.empty() && requests.front().uploaded)
+            requests.pop_front();
+    }
+
+    // decodes and uploads right away on the calling thread
+    static unsigned int LoadNow(const std::string &path, bool gamma, Wrap wrap = REPEAT)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        Image image;
+        image.path = path;
+        prepare(image, false, gamma);
+        upload(texture, image, gamma, wrap, nullptr, true);
+        release(image);
+        return texture;
+    }
+
+private:
+    struct Image {
+        std::string path;
+        // cooked textures are uploaded from the pack, the others decoded by stbi
+        CookedTexture cooked;
+        bool isCooked = false;
+        unsigned char *pixels = nullptr;
+        // RGBA layers of a texture array decoded from a cooked texture
+        std::vector<unsigned char> decoded;
+        // level 1 and below of a loose image, see MipGenerator::Generate. Direct images have them in their buffer.
+        std::vector<unsigned char> mips;
+        // pixel buffer a loose image is decoded into, isDirect once that worked
+        TextureUploader::Staging direct{nullptr, 0, 0};
+        bool isDirect = false;
+        int width = 0, height = 0, channels = 0;
+    };
+
+    struct Request {
+        unsigned int texture;
+        GLenum target;
+        bool gamma;
+        Wrap wrap;
+        std::vector<Image> images;
+        std::vector<glm::vec2> *uvScales = nullptr;
+        // images still being decoded
+        std::atomic<unsigned int> remaining;
+        bool uploaded = false;
+    };
+
+    TextureUploader *uploader;
+    ThreadPool pool;
+    // a deque keeps the images in place while workers write to them
+    std::deque<Request> requests;
+
+    Request &queue(GLenum target, bool gamma, Wrap wrap, unsigned int imageCount)
+    {
+        requests.emplace_back();
+        Request &request = requests.back();
+        glGenTextures(1, &request.texture);
+        request.target = target;
+        request.gamma = gamma;
+        request.wrap = wrap;
+        request.images.resize(imageCount);
+        request.remaining = imageCount;
+        return request;
+    }
+
+    // false when the request has to wait for staging memory
+    bool uploadRequest(Request &request, bool wait)
+    {
+        bool done;
+        if (request.target == GL_TEXTURE_2D)
+            done = upload(request.texture, request.images[0], request.gamma, request.wrap, uploader, wait);
+        else
+            done = uploadArray(request.texture, request.images, request.gamma, *request.uvScales, uploader, wait);
+        if (!done)
+            return false;
+        for (Image &image: request.images)
+            release(image);
+        request.uploaded = true;
+        return true;
+    }
+
+    // maps a pixel buffer for the decoded image followed by its mip levels, the header tells the size
+    static void reserveDirect(Image &image)
+    {
+        if (AssetPack::Contains(image.path, AssetPack::TEXTURE))
+            return;
+        if (!ImageDecoder::Info(image.path, image.width, image.height, image.channels))
+            return;
+        TextureUploader::MapDedicated(ImageDecoder::Capacity(image.width, image.height, image.channels) +
+                                      MipGenerator::ChainSize(image.width, image.height, image.channels), image.direct);
+    }
+
+    // runs on a worker. Layers of texture arrays are always RGBA, other images get their mip chain here, filtered
+    // in linear light when they are sRGB (gamma).
+    static void prepare(Image &image, bool layer, bool gamma)
+    {
+        AssetPack::Span span;
+        if (AssetPack::Find(image.path, AssetPack::TEXTURE, span) && image.cooked.Parse(span))
+        {
+            image.isCooked = true;
+            image.width = image.cooked.width;
+            image.height = image.cooked.height;
+            image.channels = image.cooked.channels;
+            if (layer)
+            {
+                image.cooked.DecodeLevel(0, image.decoded);
+                image.channels = 4;
+            }
+            return;
+        }
+        if (image.direct.dedicated)
+        {
+            image.isDirect = ImageDecoder::DecodeInto(image.path, image.channels, image.direct.data,
+                                                      ImageDecoder::Capacity(image.width, image.height, image.channels),
+                                                      image.width, image.height);
+            if (image.isDirect)
+            {
+                MipGenerator::Generate(image.direct.data, image.width, image.height, image.channels, gamma,
+                                       image.direct.data + ImageDecoder::Capacity(image.width, image.height, image.channels));
+                return;
+            }
+        }
+        image.pixels = stbi_load(image.path.c_str(), &image.width, &image.height, &image.channels, layer ? 4 : 0);
+        if (layer)
+            image.channels = 4;
+        else if (image.pixels)
+        {
+            image.mips.resize(MipGenerator::ChainSize(image.width, image.height, image.channels));
+            MipGenerator::Generate(image.pixels, image.width, image.height, image.channels, gamma, image.mips.data());
+        }
+    }
+
+    static void release(Image &image)
+    {
+        if (image.pixels)
+            stbi_image_free(image.pixels);
+        image.pixels = nullptr;
+        image.decoded.clear();
+        image.decoded.shrink_to_fit();
+        image.mips.clear();
+        image.mips.shrink_to_fit();
+        if (image.direct.dedicated)
+            TextureUploader::ReleaseDedicated(image.direct);
+        image.isDirect = false;
+    }
+
+    static bool upload(unsigned int texture, Image &image, bool gamma, Wrap wrap, TextureUploader *uploader, bool wait)
+    {
+        if (!image.isCooked && !image.pixels && !image.isDirect)
+        {
+            std::cout << "Texture failed to load at path: " << image.path << std::endl;
+            return true;
+        }
+        glBindTexture(GL_TEXTURE_2D, texture);
+        if (image.isCooked)
+        {
+            // cooked textures come with their mip levels
+            if (!image.cooked.Upload(gamma, uploader, wait))
+                return false;
+        }
+        else
+        {
+            GLenum dataFormat = GL_RGBA;
+            GLenum internalFormat = GL_RGBA;
+            if (image.channels == 1)
+                internalFormat = dataFormat = GL_RED;
+            else if (image.channels == 3) {
+                internalFormat = gamma ? GL_SRGB : GL_RGB;
+                dataFormat = GL_RGB;
+            }
+            else if (image.channels == 4){
+                internalFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
+                dataFormat = GL_RGBA;
+            }
+            // every level goes up from the same place, level 0 followed by the rest
+            size_t size = (size_t)image.width * image.height * image.channels;
+            size_t chainSize = MipGenerator::ChainSize(image.width, image.height, image.channels);
+            const unsigned char *source = image.pixels;
+            const unsigned char *chain = image.mips.data();
+            TextureUploader::Staging staging;
+            bool staged = false;
+            if (image.isDirect)
+            {
+                // already in its pixel buffer
+                if (!TextureUploader::UnmapDedicated(image.direct))
+                    return true;
+                source = TextureUploader::Source(image.direct);
+                chain = source + ImageDecoder::Capacity(image.width, image.height, image.channels);
+            }
+            else if (uploader && uploader->Fits(size + chainSize))
+            {
+                staged = uploader->Map(size + chainSize, wait, staging);
+                if (!staged && !wait)
+                    return false;
+                if (staged)
+                {
+                    std::memcpy(staging.data, image.pixels, size);
+                    std::memcpy(staging.data + size, image.mips.data(), chainSize);
+                    uploader->Unmap();
+                    source = TextureUploader::Source(staging);
+                    chain = source + size;
+                }
+            }
+            // rows are tightly packed
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, dataFormat, GL_UNSIGNED_BYTE, source);
+            unsigned int levels = MipGenerator::LevelCount(image.width, image.height);
+            for (unsigned int level = 1; level < levels; level++)
+            {
+                unsigned int width = std::max(1, image.width >> level), height = std::max(1, image.height >> level);
+                glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, chain);
+                chain += (size_t)width * height * image.channels;
+            }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+            if (image.isDirect)
+                TextureUploader::ReleaseDedicated(image.direct);
+            else if (staged)
+                uploader->Submit();
+        }
+
+        // use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
+        bool clamp = wrap == CLAMP || (wrap == CLAMP_IF_ALPHA && image.channels == 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return true;
+    }
+
+    // all layers are as large as the largest image; smaller ones are placed in the corner with their last row and
+    // column repeated, and uvScales receives for every layer the part of it the image covers. Texture coordinates
+    // have to stay inside [0, 1], so it is meant for clamped textures.
+    static bool uploadArray(unsigned int texture, const std::vector<Image> &images, bool gamma, std::vector<glm::vec2> &uvScales,
+                            TextureUploader *uploader, bool wait)
+    {
+        std::vector<const unsigned char*> layers(images.size());
+        int width = 1, height = 1;
+        for (unsigned int i = 0; i < images.size(); i++)
+        {
+            layers[i] = images[i].isCooked ? images[i].decoded.data() : images[i].pixels;
+            if (!layers[i])
+                continue;
+            width = std::max(width, images[i].width);
+            height = std::max(height, images[i].height);
+        }
+
+        // storage first: Map leaves the staging buffer bound, and a NULL pointer would then be an offset into it
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, gamma ? GL_SRGB_ALPHA : GL_RGBA, width, height, images.size(), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        // the padded layers are written straight into staging memory when it has room for all of them
+        size_t layerSize = (size_t)width * height * 4;
+        TextureUploader::Staging staging;
+        bool staged = false;
+        if (uploader && uploader->Fits(layerSize * images.size()))
+        {
+            staged = uploader->Map(layerSize * images.size(), wait, staging);
+            if (!staged && !wait)
+            {
+                glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+                return false;
+            }
+        }
+        std::vector<unsigned char> layer(staged ? 0 : layerSize);
+
+        uvScales.assign(images.size(), glm::vec2(1.0f));
+        for (unsigned int i = 0; i < images.size(); i++)
+        {
+            const Image &image = images[i];
+            unsigned char *destination = staged ? staging.data + i * layerSize : layer.data();
+            if (!layers[i])
+            {
+                std::cout << "Texture failed to load at path: " << image.path << std::endl;
+                if (staged)
+                    std::memset(destination, 0, layerSize);
+                continue;
+            }
+            // repeat the border of the image into the padding so filtering at its edge does not pick up anything else
+            for (int y = 0; y < height; y++)
+            {
+                const unsigned char *row = layers[i] + std::min(y, image.height - 1) * image.width * 4;
+                for (int x = 0; x < width; x++)
+                    std::memcpy(&destination[(y * width + x) * 4], row + std::min(x, image.width - 1) * 4, 4);
+            }
+            if (!staged)
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, layer.data());
+            uvScales[i] = glm::vec2((float)image.width / width, (float)image.height / height);
+        }
+        if (staged)
+        {
+            // one copy for all layers, straight from the buffer
+            uploader->Unmap();
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, width, height, images.size(), GL_RGBA, GL_UNSIGNED_BYTE,
+                            TextureUploader::Source(staging));
+            uploader->Submit();
+        }
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef TEXTURE_UPLOADER_H
+#define TEXTURE_UPLOADER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+
+// staging memory for texture uploads: a ring inside one GL_PIXEL_UNPACK_BUFFER.
+// Pixels are copied into a mapped region and the texture calls read them from the buffer, so the driver
+// schedules the copy to the texture instead of copying out of client memory before the call returns.
+// Every region is fenced after use and handed out again once the GPU is done with it.
+//
+// Per texture: Map, write the pixels, Unmap, issue the glTex*Image* calls with Source(staging) + offset as
+// the pixel pointer, Submit.
+// Pixels written by another thread go to a dedicated buffer instead (MapDedicated), which can stay mapped
+// while the frame goes on.
+class TextureUploader
+{
+public:
+    struct Staging {
+        unsigned char *data;
+        // byte offset of data in buffer
+        GLintptr offset;
+        // the buffer of MapDedicated, 0 for ring memory
+        unsigned int dedicated;
+    };
+
+    unsigned int buffer = 0;
+
+    void Create(GLsizeiptr capacity)
+    {
+        this->capacity = capacity;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // whether size bytes can be staged at all
+    bool Fits(GLsizeiptr size) const
+    {
+        return buffer != 0 && size <= capacity;
+    }
+
+    // maps size bytes of the ring. When the GPU still reads from all free space this waits for it, or returns
+    // false without wait so the caller can try again next frame.
+    bool Map(GLsizeiptr size, bool wait, Staging &staging)
+    {
+        if (size <= 0 || !Fits(size))
+            return false;
+        GLintptr start;
+        while (!allocate(size, start))
+        {
+            if (regions.empty() || !retireOldest(wait))
+                return false;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        // the fences guarantee the range isn't read anymore, so there is nothing to synchronize with
+        void *data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, start, size,
+                                      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (!data)
+        {
+            std::cout << "ERROR::TEXTURE_UPLOADER:: mapping the staging buffer failed" << std::endl;
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return false;
+        }
+        head = start + size;
+        pending = Region{0, start};
+        staging = Staging{(unsigned char*)data, start, 0};
+        return true;
+    }
+
+    // ends the writes, the buffer stays bound to GL_PIXEL_UNPACK_BUFFER for the texture calls
+    void Unmap()
+    {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    // the pixel pointer that makes texture calls read staging
+    static const unsigned char *Source(const Staging &staging)
+    {
+        return (const unsigned char*)(uintptr_t)staging.offset;
+    }
+
+    // after the texture calls: unbinds the buffer and fences the region
+    void Submit()
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        pending.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        regions.push_back(pending);
+    }
+
+    // a pixel buffer of its own for size bytes, mapped until UnmapDedicated. Any thread may fill it.
+    static bool MapDedicated(GLsizeiptr size, Staging &staging)
+    {
+        unsigned int dedicated;
+        glGenBuffers(1, &dedicated);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, dedicated);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        void *data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!data)
+        {
+            std::cout << "ERROR::TEXTURE_UPLOADER:: mapping a dedicated staging buffer failed" << std::endl;
+            glDeleteBuffers(1, &dedicated);
+            return false;
+        }
+        staging = Staging{(unsigned char*)data, 0, dedicated};
+        return true;
+    }
+
+    // ends the writes and binds the buffer for the texture calls, false when its contents got lost meanwhile
+    static bool UnmapDedicated(const Staging &staging)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.dedicated);
+        if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE)
+            return true;
+        std::cout << "ERROR::TEXTURE_UPLOADER:: a dedicated staging buffer lost its contents" << std::endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+
+    // after the texture calls, or to drop it unused. GL keeps the storage until the copies are done.
+    static void ReleaseDedicated(Staging &staging)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &staging.dedicated);
+        staging.dedicated = 0;
+    }
+
+    void Delete()
+    {
+        for (Region &region: regions)
+            glDeleteSync(region.fence);
+        regions.clear();
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+private:
+    // a range in flight, regions are allocated and retired in ring order
+    struct Region {
+        GLsync fence;
+        GLintptr start;
+    };
+
+    GLsizeiptr capacity = 0;
+    GLintptr head = 0;
+    std::deque<Region> regions;
+    Region pending;
+
+    // finds room for size bytes behind head, wrapping to the start of the buffer when the end is too short
+    bool allocate(GLsizeiptr size, GLintptr &start)
+    {
+        // pixel rows and compressed blocks are fine with 16 byte alignment
+        GLintptr aligned = (head + 15) & ~GLintptr(15);
+        if (regions.empty())
+        {
+            start = aligned + size <= capacity ? aligned : 0;
+            return true;
+        }
+        GLintptr tail = regions.front().start;
+        if (head > tail)
+        {
+            // free space is [head, capacity) and [0, tail)
+            if (aligned + size <= capacity)
+            {
+                start = aligned;
+                return true;
+            }
+            if (size <= tail)
+            {
+                start = 0;
+                return true;
+            }
+            return false;
+        }
+        // wrapped, free space is [head, tail)
+        if (aligned + size <= tail)
+        {
+            start = aligned;
+            return true;
+        }
+        return false;
+    }
+
+    // frees the oldest region once the GPU is done with it, false when it isn't and wait is not set
+    bool retireOldest(bool wait)
+    {
+        Region &oldest = regions.front();
+        GLenum result = glClientWaitSync(oldest.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+        while (wait && result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(oldest.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        if (result == GL_TIMEOUT_EXPIRED)
+            return false;
+        if (result == GL_WAIT_FAILED)
+            std::cout << "ERROR::TEXTURE_UPLOADER:: waiting for the GPU failed" << std::endl;
+        glDeleteSync(oldest.fence);
+        regions.pop_front();
+        if (regions.empty())
+            head = 0;
+        return true;
+    }
+};
+
+#endif
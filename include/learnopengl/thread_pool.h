@@ -0,0 +1,95 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads taking tasks from one queue. Tasks must not touch GL, the context belongs to
+// the main thread.
+class ThreadPool
+{
+public:
+    // threadCount 0 leaves one core for the main thread
+    explicit ThreadPool(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this] { work(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool &operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskAdded.notify_all();
+        for (std::thread &worker: workers)
+            worker.join();
+    }
+
+    void Enqueue(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+            pending++;
+        }
+        taskAdded.notify_one();
+    }
+
+    // blocks until every task enqueued so far has finished
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this] { return pending == 0; });
+    }
+
+    unsigned int ThreadCount() const
+    {
+        return workers.size();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAdded;
+    std::condition_variable allDone;
+    // queued plus running
+    unsigned int pending = 0;
+    bool stopping = false;
+
+    void work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskAdded.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+            allDone.notify_all();
+        }
+    }
+};
+
+#endif
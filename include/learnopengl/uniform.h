@@ -0,0 +1,227 @@
+#ifndef UNIFORM_H
+#define UNIFORM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// FNV-1a, a constant expression when the text is one
+constexpr uint32_t fnv1a(const char *text)
+{
+    uint32_t hash = 2166136261u;
+    while (*text)
+    {
+        hash ^= (uint8_t)*text++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// name of a uniform, only the hash is used to look it up
+struct UniformName {
+    uint32_t hash;
+    const char *name;
+};
+
+// hashes a string literal at compile time, e.g. shader.getUniform<glm::mat4>(UNIFORM("model"))
+#define UNIFORM(name) (UniformName{std::integral_constant<uint32_t, fnv1a(name)>::value, name})
+
+// resolved location of a uniform of GLSL type T, setting it does no string work and no GL queries
+template<typename T>
+struct UniformHandle {
+    GLint location = -1;
+};
+
+// every sampler type of GLSL 3.30
+inline bool isSamplerType(GLenum type)
+{
+    switch (type)
+    {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_RECT: case GL_SAMPLER_BUFFER:
+        case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW: case GL_SAMPLER_2D_RECT_SHADOW:
+        case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+        case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_2D_RECT: case GL_INT_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+            return true;
+    }
+    return false;
+}
+
+// which GLSL types a C++ type may be written to
+template<typename T> struct UniformType;
+template<> struct UniformType<float> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT; }
+};
+template<> struct UniformType<bool> {
+    static bool accepts(GLenum type) { return type == GL_BOOL || type == GL_INT; }
+};
+template<> struct UniformType<int> {
+    static bool accepts(GLenum type)
+    {
+        switch (type)
+        {
+            case GL_INT: case GL_BOOL:
+                return true;
+        }
+        return isSamplerType(type);
+    }
+};
+template<> struct UniformType<glm::vec2> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC2; }
+};
+template<> struct UniformType<glm::vec3> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC3; }
+};
+template<> struct UniformType<glm::vec4> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT_VEC4; }
+};
+template<> struct UniformType<glm::mat2> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT2; }
+};
+template<> struct UniformType<glm::mat3> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT3; }
+};
+template<> struct UniformType<glm::mat4> {
+    static bool accepts(GLenum type) { return type == GL_FLOAT_MAT4; }
+};
+
+// the program has to be in use, like for the glUniform* calls themselves
+inline void setUniformValue(GLint location, bool value) { glUniform1i(location, (int)value); }
+inline void setUniformValue(GLint location, int value) { glUniform1i(location, value); }
+inline void setUniformValue(GLint location, float value) { glUniform1f(location, value); }
+inline void setUniformValue(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, &value[0]); }
+inline void setUniformValue(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, &value[0]); }
+inline void setUniformValue(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, &value[0]); }
+inline void setUniformValue(GLint location, const glm::mat2 &mat) { glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]); }
+inline void setUniformValue(GLint location, const glm::mat3 &mat) { glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]); }
+inline void setUniformValue(GLint location, const glm::mat4 &mat) { glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]); }
+
+// every active uniform of a linked program, found with glGetActiveUniform and sorted by name hash
+class UniformTable
+{
+public:
+    struct Entry {
+        uint32_t hash;
+        GLint location;
+        GLenum type;
+        // first texture unit of a sampler (arrays take one per element), -1 for other types
+        GLint unit;
+        // elements of an array, 1 otherwise
+        GLint size;
+    };
+
+    void reflect(GLuint program)
+    {
+        entries.clear();
+        std::vector<std::pair<GLint, GLint>> samplers;
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> name(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(program, i, name.size(), NULL, &size, &type, name.data());
+            // members of uniform blocks have no location
+            GLint location = glGetUniformLocation(program, name.data());
+            if (location < 0)
+                continue;
+            if (isSamplerType(type))
+                samplers.push_back(std::make_pair(location, size));
+            entries.push_back(Entry{fnv1a(name.data()), location, type, -1, size});
+            // arrays are reported as "name[0]", they can be set by their plain name as well
+            std::string arrayName(name.data());
+            if (arrayName.size() > 3 && arrayName.compare(arrayName.size() - 3, 3, "[0]") == 0)
+                entries.push_back(Entry{fnv1a(arrayName.substr(0, arrayName.size() - 3).c_str()), location, type, -1, size});
+        }
+        // samplers get consecutive units in the order of their locations, so every user of the program agrees on them
+        std::sort(samplers.begin(), samplers.end());
+        GLint nextUnit = 0;
+        for (const auto &sampler: samplers)
+        {
+            for (Entry &entry: entries)
+                if (entry.location == sampler.first)
+                    entry.unit = nextUnit;
+            nextUnit += sampler.second;
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.hash < b.hash; });
+        for (unsigned int i = 1; i < entries.size(); i++)
+            if (entries[i].hash == entries[i - 1].hash)
+                std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION in program " << program << std::endl;
+    }
+
+    const Entry *find(uint32_t hash) const
+    {
+        auto it = std::lower_bound(entries.begin(), entries.end(), hash,
+                                   [](const Entry &entry, uint32_t value) { return entry.hash < value; });
+        if (it == entries.end() || it->hash != hash)
+            return nullptr;
+        return &*it;
+    }
+
+    // -1 (ignored by glUniform*) when the program has no such uniform, like glGetUniformLocation
+    GLint location(uint32_t hash) const
+    {
+        const Entry *entry = find(hash);
+        return entry ? entry->location : -1;
+    }
+
+    // sets every sampler of the program to its unit, the elements of a sampler array to consecutive units.
+    // Samplers of different types must never share one. Leaves the program in use.
+    void assignSamplerUnits(GLuint program) const
+    {
+        glUseProgram(program);
+        std::vector<GLint> units;
+        for (const Entry &entry: entries)
+        {
+            if (entry.unit < 0)
+                continue;
+            units.resize(entry.size);
+            for (GLint i = 0; i < entry.size; i++)
+                units[i] = entry.unit + i;
+            glUniform1iv(entry.location, entry.size, units.data());
+        }
+    }
+
+    // -1 when the program has no such sampler
+    GLint samplerUnit(uint32_t hash) const
+    {
+        const Entry *entry = find(hash);
+        return entry ? entry->unit : -1;
+    }
+
+    template<typename T>
+    UniformHandle<T> handle(const UniformName &name) const
+    {
+        UniformHandle<T> result;
+        const Entry *entry = find(name.hash);
+        if (entry == nullptr)
+            return result;
+        if (!UniformType<T>::accepts(entry->type))
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH for " << name.name << std::endl;
+            return result;
+        }
+        result.location = entry->location;
+        return result;
+    }
+
+private:
+    std::vector<Entry> entries;
+};
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <learnopengl/bounds.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// how a mesh keeps its vertices on the GPU
+enum VertexFormat {
+    // Vertex as it is, 56 bytes
+    FULL_VERTICES,
+    // PackedVertex, 20 bytes
+    PACKED_VERTICES
+};
+
+// a vertex quantized for drawing. The shader reads it through normalized attributes and undoes the rest:
+// positions are fractions of the mesh bounds (positionOffset + aPos.xyz * positionScale), the normal is
+// octahedral encoded and the tangent frame is the quaternion rotating the tangent space axes onto (T, B, N).
+struct PackedVertex {
+    // unorm16 inside the mesh bounds, w is 1 when the bitangent is cross(N, T) and 0 when it is flipped
+    uint16_t position[4];
+    // octahedral normal, snorm16
+    int16_t normal[2];
+    // unorm 10_10_10_2: the three smallest quaternion components (in [-1/sqrt(2), 1/sqrt(2)], mapped onto
+    // [0, 1]) and in the 2 bit field which one was left out. The left out one is positive and follows from
+    // the length being 1.
+    uint32_t tangentFrame;
+    // half floats
+    uint16_t texCoords[2];
+};
+
+class VertexPacking
+{
+public:
+    // what the shader needs to restore positions from PackedVertex::position
+    struct PositionDecode {
+        glm::vec3 offset;
+        glm::vec3 scale;
+    };
+
+    static PositionDecode Decode(const AABB &bounds)
+    {
+        return PositionDecode{bounds.min, bounds.max - bounds.min};
+    }
+
+    // packs vertices (Vertex of mesh.h) relative to bounds, which have to enclose every position
+    template<typename V>
+    static void Pack(const V *vertices, size_t count, const AABB &bounds, std::vector<PackedVertex> &packed)
+    {
+        glm::vec3 extent = bounds.max - bounds.min;
+        glm::vec3 inverse(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+                          extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                          extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+        packed.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            const V &vertex = vertices[i];
+            PackedVertex &out = packed[i];
+            glm::vec3 position = glm::clamp((vertex.Position - bounds.min) * inverse, 0.0f, 1.0f);
+            for (int c = 0; c < 3; c++)
+                out.position[c] = (uint16_t)std::lround(position[c] * 65535.0f);
+
+            glm::vec3 normal = safeNormalize(vertex.Normal, glm::vec3(0.0f, 0.0f, 1.0f));
+            glm::vec2 octahedral = EncodeOctahedral(normal);
+            out.normal[0] = snorm16(octahedral.x);
+            out.normal[1] = snorm16(octahedral.y);
+
+            bool flipped;
+            out.tangentFrame = PackTangentFrame(normal, vertex.Tangent, vertex.Bitangent, flipped);
+            out.position[3] = flipped ? 0 : 65535;
+            out.texCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+            out.texCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+        }
+    }
+
+    // unit vector onto the octahedron, unfolded into [-1, 1]^2
+    static glm::vec2 EncodeOctahedral(const glm::vec3 &n)
+    {
+        glm::vec2 p = glm::vec2(n.x, n.y) / (std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z));
+        if (n.z < 0.0f)
+            p = fold(p);
+        return p;
+    }
+
+    static glm::vec3 DecodeOctahedral(const glm::vec2 &p)
+    {
+        glm::vec3 n(p.x, p.y, 1.0f - std::fabs(p.x) - std::fabs(p.y));
+        if (n.z < 0.0f)
+        {
+            glm::vec2 folded = fold(p);
+            n.x = folded.x;
+            n.y = folded.y;
+        }
+        return glm::normalize(n);
+    }
+
+    // the rotation taking x, y, z onto the orthonormalized tangent, cross(normal, tangent) and normal. flipped
+    // tells whether bitangent points the other way.
+    static uint32_t PackTangentFrame(const glm::vec3 &normal, const glm::vec3 &tangent, const glm::vec3 &bitangent, bool &flipped)
+    {
+        glm::vec3 t = tangent - normal * glm::dot(normal, tangent);
+        // meshes without texture coordinates have no tangents, any perpendicular axis will do
+        glm::vec3 fallback = std::fabs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        t = safeNormalize(t, glm::normalize(fallback - normal * glm::dot(normal, fallback)));
+        glm::vec3 b = glm::cross(normal, t);
+        flipped = glm::dot(b, bitangent) < 0.0f;
+        glm::vec4 q = rotationToQuaternion(t, b, normal);
+
+        unsigned int largest = 0;
+        for (unsigned int c = 1; c < 4; c++)
+            if (std::fabs(q[c]) > std::fabs(q[largest]))
+                largest = c;
+        // q and -q are the same rotation
+        float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+        uint32_t packed = largest << 30;
+        unsigned int shift = 0;
+        for (unsigned int c = 0; c < 4; c++)
+        {
+            if (c == largest)
+                continue;
+            float value = glm::clamp(sign * q[c] * 0.70710678f + 0.5f, 0.0f, 1.0f);
+            packed |= uint32_t(std::lround(value * 1023.0f)) << shift;
+            shift += 10;
+        }
+        return packed;
+    }
+
+    // inverse of PackTangentFrame, (x, y, z, w)
+    static glm::vec4 UnpackTangentFrame(uint32_t packed)
+    {
+        unsigned int largest = packed >> 30;
+        glm::vec4 q;
+        float sum = 0.0f;
+        unsigned int shift = 0;
+        for (unsigned int c = 0; c < 4; c++)
+        {
+            if (c == largest)
+                continue;
+            q[c] = (((packed >> shift) & 0x3ff) / 1023.0f - 0.5f) * 1.41421356f;
+            sum += q[c] * q[c];
+            shift += 10;
+        }
+        q[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+        return q;
+    }
+
+private:
+    // (x, y, z, w) of the rotation whose matrix has the columns x, y and z, from its largest component
+    static glm::vec4 rotationToQuaternion(const glm::vec3 &x, const glm::vec3 &y, const glm::vec3 &z)
+    {
+        float trace = x.x + y.y + z.z;
+        glm::vec4 q;
+        if (trace > 0.0f)
+        {
+            float s = std::sqrt(trace + 1.0f) * 2.0f;
+            q = glm::vec4((y.z - z.y) / s, (z.x - x.z) / s, (x.y - y.x) / s, 0.25f * s);
+        }
+        else if (x.x > y.y && x.x > z.z)
+        {
+            float s = std::sqrt(1.0f + x.x - y.y - z.z) * 2.0f;
+            q = glm::vec4(0.25f * s, (y.x + x.y) / s, (z.x + x.z) / s, (y.z - z.y) / s);
+        }
+        else if (y.y > z.z)
+        {
+            float s = std::sqrt(1.0f + y.y - x.x - z.z) * 2.0f;
+            q = glm::vec4((y.x + x.y) / s, 0.25f * s, (z.y + y.z) / s, (z.x - x.z) / s);
+        }
+        else
+        {
+            float s = std::sqrt(1.0f + z.z - x.x - y.y) * 2.0f;
+            q = glm::vec4((z.x + x.z) / s, (z.y + y.z) / s, 0.25f * s, (x.y - y.x) / s);
+        }
+        return glm::normalize(q);
+    }
+
+    // mirrors the lower hemisphere over the diagonals of the square, its own inverse
+    static glm::vec2 fold(const glm::vec2 &p)
+    {
+        return glm::vec2((1.0f - std::fabs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                         (1.0f - std::fabs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+    }
+
+    static glm::vec3 safeNormalize(const glm::vec3 &v, const glm::vec3 &fallback)
+    {
+        float length = glm::length(v);
+        return length > 1e-6f ? v / length : fallback;
+    }
+
+    static int16_t snorm16(float value)
+    {
+        return (int16_t)std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+    }
+};
+
+#endif
@@ -1,2 +1,8 @@
+#include <learnopengl/image_decoder.h>
+
+// decodes can write straight into memory handed to ImageDecoder::DecodeInto
+#define STBI_MALLOC(size) ImageDecoder::Allocate(size)
+#define STBI_REALLOC(pointer, size) ImageDecoder::Reallocate(pointer, size)
+#define STBI_FREE(pointer) ImageDecoder::Free(pointer)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
\ No newline at end of file
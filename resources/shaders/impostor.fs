@@ -0,0 +1,77 @@
+#version 330 core
+out vec4 FragColor;
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+in vec2 AtlasCoords;
+in vec3 FragPos;
+flat in mat3 ModelRotation;
+
+uniform sampler2D albedoAtlas;
+uniform sampler2D normalAtlas;
+
+// per-frame camera and light state shared by all programs, see FrameData in frame_uniforms.h
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+    float time;
+    DirLight dirLight;
+    SpotLight spotLight;
+    int spotLightOn;
+};
+
+// same lighting as omnishader.fs, with the baked albedo and normal
+vec3 CalcDirLight(DirLight light, vec3 albedo, vec3 normal)
+{
+    vec3 lightDir = normalize(-light.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+    return light.ambient * albedo + light.diffuse * diff * albedo;
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 albedo, vec3 normal, vec3 fragPos)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(normal, lightDir), max(dot(-normal, lightDir), 0.0));
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    return (light.ambient * albedo + light.diffuse * diff * albedo) * attenuation * intensity;
+}
+
+void main()
+{
+    vec4 albedo = texture(albedoAtlas, AtlasCoords);
+    if(albedo.a < 0.5)
+        discard;
+    vec3 normal = normalize(ModelRotation * (texture(normalAtlas, AtlasCoords).xyz * 2.0 - 1.0));
+    vec3 result = CalcDirLight(dirLight, albedo.rgb, normal);
+    if(spotLightOn > 0)
+        result += CalcSpotLight(spotLight, albedo.rgb, normal, FragPos);
+    //gamma correction
+    result = pow(result, vec3(1.0/2.2));
+    FragColor = vec4(result, 1.0);
+}
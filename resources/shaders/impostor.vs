@@ -0,0 +1,93 @@
+#version 330 core
+layout (location = 0) in vec2 aCorner;
+// per-instance model matrix, same layout as for the full trees
+layout (location = 5) in mat4 aInstanceModel;
+
+out vec2 AtlasCoords;
+out vec3 FragPos;
+flat out mat3 ModelRotation;
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// per-frame camera and light state shared by all programs, see FrameData in frame_uniforms.h
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+    float time;
+    DirLight dirLight;
+    SpotLight spotLight;
+    int spotLightOn;
+};
+
+// bounding sphere of the model in model space (center, radius)
+uniform vec4 sphere;
+uniform int framesPerSide;
+
+float signNotZero(float value)
+{
+    return value >= 0.0 ? 1.0 : -1.0;
+}
+
+// octahedral mapping used by Impostor::octEncode/octDecode when baking
+vec2 octEncode(vec3 direction)
+{
+    direction /= abs(direction.x) + abs(direction.y) + abs(direction.z);
+    vec2 p = direction.xz;
+    if(direction.y < 0.0)
+        p = vec2((1.0 - abs(p.y)) * signNotZero(p.x), (1.0 - abs(p.x)) * signNotZero(p.y));
+    return p * 0.5 + 0.5;
+}
+
+vec3 octDecode(vec2 uv)
+{
+    vec2 e = uv * 2.0 - 1.0;
+    vec3 direction = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    if(direction.y < 0.0)
+        direction.xz = vec2((1.0 - abs(e.y)) * signNotZero(e.x), (1.0 - abs(e.x)) * signNotZero(e.y));
+    return normalize(direction);
+}
+
+void main()
+{
+    vec3 center = vec3(aInstanceModel * vec4(sphere.xyz, 1.0));
+    float scale = length(aInstanceModel[0].xyz);
+    mat3 rotation = mat3(aInstanceModel) / scale;
+
+    // pick the baked frame closest to the direction the instance is seen from
+    vec3 toViewer = transpose(rotation) * normalize(viewPosition - center);
+    vec2 frame = clamp(floor(octEncode(toViewer) * float(framesPerSide)), 0.0, float(framesPerSide - 1));
+    vec3 frameDirection = octDecode((frame + 0.5) / float(framesPerSide));
+
+    // the quad is oriented like the camera that baked the frame, then turned with the instance
+    vec3 up = abs(frameDirection.y) > 0.99 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(-frameDirection, up));
+    up = cross(right, -frameDirection);
+    vec3 offset = rotation * (aCorner.x * right + aCorner.y * up) * sphere.w * scale;
+
+    FragPos = center + offset;
+    AtlasCoords = (frame + aCorner * 0.5 + 0.5) / float(framesPerSide);
+    ModelRotation = rotation;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
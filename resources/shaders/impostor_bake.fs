@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) out vec4 Albedo;
+layout (location = 1) out vec4 NormalOut;
+
+struct Material {
+    sampler2D texture_diffuse1;
+};
+in vec2 TexCoords;
+in vec3 Normal;
+
+uniform Material material;
+
+void main()
+{
+    vec4 albedo = texture(material.texture_diffuse1, TexCoords);
+    if(albedo.a < 0.1)
+        discard;
+    Albedo = vec4(albedo.rgb, 1.0);
+    // model space normal packed into [0, 1]
+    NormalOut = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+}
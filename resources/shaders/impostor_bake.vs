@@ -0,0 +1,32 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+out vec3 Normal;
+
+// the model is baked in its own space, so there is no model matrix
+uniform mat4 view;
+uniform mat4 projection;
+// meshes with packed vertices (PackedVertex in vertex_packing.h) store positions as fractions of their bounds
+// and octahedral normals
+uniform bool packedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 position = packedVertices ? positionOffset + aPos * positionScale : aPos;
+    Normal = packedVertices ? decodeOctahedral(aNormal.xy) : aNormal;
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * vec4(position, 1.0);
+}
@@ -33,13 +33,25 @@ struct Material {
 in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
+// layer of layeredDiffuse to read instead of material.texture_diffuse1, negative when not layered
+flat in float MaterialLayer;
 
 uniform Material material;
-uniform DirLight dirLight;
-uniform SpotLight spotLight;
-uniform int spotLightOn;
+uniform sampler2DArray layeredDiffuse;
 
-uniform vec3 viewPosition;
+// diffuse texel of the fragment, sampled once in main
+vec3 diffuseColor;
+
+// per-frame camera and light state shared by all programs, see FrameData in frame_uniforms.h
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+    float time;
+    DirLight dirLight;
+    SpotLight spotLight;
+    int spotLightOn;
+};
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
 {
@@ -52,9 +64,9 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 halfwayDir = normalize(viewDir + lightDir);
     float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_diffuse1, TexCoords));
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * diffuseColor;
     return (ambient + diffuse + specular);
 }
 
@@ -76,9 +88,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_diffuse1, TexCoords));
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * diffuseColor;
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
@@ -87,9 +99,11 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 
 void main()
 {
-    vec4 blendTexture = texture(material.texture_diffuse1, TexCoords);
+    vec4 blendTexture = MaterialLayer >= 0.0 ? texture(layeredDiffuse, vec3(TexCoords, MaterialLayer))
+                                             : texture(material.texture_diffuse1, TexCoords);
     if(blendTexture.a < 0.1)
         discard;
+    diffuseColor = blendTexture.rgb;
     vec3 normal = normalize(Normal);
     vec3 viewDir = normalize(viewPosition - FragPos);
     vec3 result = CalcDirLight(dirLight, normal, viewDir);
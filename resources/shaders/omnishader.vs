@@ -2,19 +2,72 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per-instance model matrix, only read when instanced is set
+layout (location = 5) in mat4 aInstanceModel;
 
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
+flat out float MaterialLayer;
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// per-frame camera and light state shared by all programs, see FrameData in frame_uniforms.h
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+    float time;
+    DirLight dirLight;
+    SpotLight spotLight;
+    int spotLightOn;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool instanced;
+// meshes with packed vertices (PackedVertex in vertex_packing.h) store positions as fractions of their bounds
+// and octahedral normals
+uniform bool packedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    vec3 position = packedVertices ? positionOffset + aPos * positionScale : aPos;
+    vec3 normal = packedVertices ? decodeOctahedral(aNormal.xy) : aNormal;
+    mat4 modelMatrix = instanced ? aInstanceModel : model;
+    FragPos = vec3(modelMatrix * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(modelMatrix))) * normal;
     TexCoords = aTexCoords;
+    MaterialLayer = -1.0;
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
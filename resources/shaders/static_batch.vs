@@ -0,0 +1,65 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+// index of the draw in the batch, see StaticBatch in static_batch.h
+layout (location = 3) in uint aDrawIndex;
+
+out vec2 TexCoords;
+out vec3 Normal;
+out vec3 FragPos;
+flat out float MaterialLayer;
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// per-frame camera and light state shared by all programs, see FrameData in frame_uniforms.h
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+    float time;
+    DirLight dirLight;
+    SpotLight spotLight;
+    int spotLightOn;
+};
+
+// 8 texels per draw: model matrix columns, normal matrix columns,
+// material (texture array layer or -1, scale of the texture coordinates to the image inside the layer)
+uniform samplerBuffer draws;
+
+void main()
+{
+    int base = int(aDrawIndex) * 8;
+    mat4 model = mat4(texelFetch(draws, base), texelFetch(draws, base + 1),
+                      texelFetch(draws, base + 2), texelFetch(draws, base + 3));
+    mat3 normalMatrix = mat3(texelFetch(draws, base + 4).xyz, texelFetch(draws, base + 5).xyz,
+                             texelFetch(draws, base + 6).xyz);
+    vec4 material = texelFetch(draws, base + 7);
+    MaterialLayer = material.x;
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = normalMatrix * aNormal;
+    TexCoords = aTexCoords * material.yz;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
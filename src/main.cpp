@@ -11,17 +11,26 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <learnopengl/filesystem.h>
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/program_cache.h>
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/bvh.h>
+#include <learnopengl/impostor.h>
+#include <learnopengl/frame_uniforms.h>
+#include <learnopengl/render_queue.h>
+#include <learnopengl/static_batch.h>
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/texture_loader.h>
 #include <rg/Error.h>
 #include <iostream>
+#include <vector>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow *window);
-unsigned int loadTexture(const char *path, bool gamma);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -39,28 +48,8 @@ float lastFrame = 0.0f;
 //flashlight on/off
 bool flashlightOn = false;
 
-struct DirLight {
-    glm::vec3 direction;
-
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-};
-
-struct SpotLight {
-    glm::vec3 position;
-    glm::vec3 direction;
-    float cutOff;
-    float outerCutOff;
-
-    float constant;
-    float linear;
-    float quadratic;
-
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-};
+// trees farther away than this are drawn as impostors
+float impostorDistance = 90.0f;
 
 // Code so we can swap to and from fullscreen
 GLFWmonitor *monitor;
@@ -106,6 +95,11 @@ int main()
         return -1;
     }
 
+    // assets written by asset_cooker, anything it doesn't have is loaded from resources/
+    AssetPack::Mount(FileSystem::getPath("resources.pack"));
+    // programs linked by earlier runs, a shader is only compiled again when its sources or the driver changed
+    ProgramCache::Enable((GLADloadproc)glfwGetProcAddress);
+
     //floor
     float planeVertices[] = {
             // positions                normals       texture coords
@@ -165,71 +159,22 @@ int main()
         treeModelMatrices[i] = tmpMat;
     }
 
-    // plane VAO
-    unsigned int planeVAO, planeVBO;
-    glGenVertexArrays(1, &planeVAO);
-    glGenBuffers(1, &planeVBO);
-    glBindVertexArray(planeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2,GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-
-    // sky VAO
-    unsigned int skyVAO, skyVBO;
-    glGenVertexArrays(1, &skyVAO);
-    glGenBuffers(1, &skyVBO);
-    glBindVertexArray(skyVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, skyVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyVertices), &skyVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2,GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-
-
-    // wall VAO
-    unsigned int wallVAO, wallVBO;
-    glGenVertexArrays(1, &wallVAO);
-    glGenBuffers(1, &wallVBO);
-    glBindVertexArray(wallVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, wallVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(wallVertices), &wallVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-
-    // transparent VAO
-    unsigned int transparentVAO, transparentVBO;
-    glGenVertexArrays(1, &transparentVAO);
-    glGenBuffers(1, &transparentVBO);
-    glBindVertexArray(transparentVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(transparentVertices), transparentVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2,GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glBindVertexArray(0);
-    
-    unsigned int noteTexture1 = loadTexture("resources/textures/its3.png",true);
-    unsigned int noteTexture2 = loadTexture("resources/textures/not3.png",true);
-    unsigned int noteTexture3 = loadTexture("resources/textures/real3.png",true);
-
-    unsigned int floorTexture = loadTexture("resources/textures/floor.jpeg",true);
-    unsigned int skyTexture = loadTexture("resources/textures/cloud.jpeg",true);
-    unsigned int wallTexture = loadTexture("resources/textures/mountain.jpeg",true);
+    // images are decoded on worker threads while the shaders compile and the tree is imported,
+    // textureLoader.Finish uploads them before anything is drawn. The pixels are staged in a pixel buffer, so
+    // the copies into the textures run on the GPU timeline.
+    TextureUploader textureUploader;
+    textureUploader.Create(32 << 20);
+    TextureLoader textureLoader(&textureUploader);
+    // the notes are layers of one array texture, so they are drawn together
+    std::vector<glm::vec2> noteScales;
+    unsigned int noteTextures = textureLoader.LoadArray({"resources/textures/its3.png",
+                                                         "resources/textures/not3.png",
+                                                         "resources/textures/real3.png"}, true, noteScales);
+
+    // shared through the cache with anything else that loads the same files
+    TextureCache::Handle floorTexture = TextureCache::Load("resources/textures/floor.jpeg", true, TextureLoader::CLAMP_IF_ALPHA, &textureLoader);
+    TextureCache::Handle skyTexture = TextureCache::Load("resources/textures/cloud.jpeg", true, TextureLoader::CLAMP_IF_ALPHA, &textureLoader);
+    TextureCache::Handle wallTexture = TextureCache::Load("resources/textures/mountain.jpeg", true, TextureLoader::CLAMP_IF_ALPHA, &textureLoader);
 
 
     // configure global opengl state
@@ -240,10 +185,85 @@ int main()
     // -------------------------
     Shader modelShader("resources/shaders/omnishader.vs", "resources/shaders/omnishader.fs");
 
-    // load tree model
-    Model treeModel("resources/objects/Tree/Tree.obj", true);
+    // load tree model, a hundred of them are drawn so the vertices are packed to 20 bytes
+    Model treeModel("resources/objects/Tree/Tree.obj", true, &textureLoader, PACKED_VERTICES, GPU_ONLY);
     treeModel.SetShaderTextureNamePrefix("material.");
 
+    // everything below samples the textures (and needs the size of the notes)
+    textureLoader.Finish();
+
+    // floor, sky, walls and notes never move, they are baked into one buffer at startup and
+    // drawn with one call per texture
+    Shader staticShader("resources/shaders/static_batch.vs", "resources/shaders/omnishader.fs");
+    StaticBatch staticBatch;
+    // floor
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::scale(model, glm::vec3(15.0f));
+    staticBatch.Add(planeVertices, 6, model, floorTexture.Id());
+    // sky
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, 35.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(15.0f));
+    staticBatch.Add(skyVertices, 6, model, skyTexture.Id());
+    //front wall
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, 15.0f, -75.0f));
+    model = glm::scale(model, glm::vec3(75.0f));
+    staticBatch.Add(wallVertices, 6, model, wallTexture.Id());
+    //back wall
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, 15.0f, 75.0f));
+    model = glm::rotate(model, glm::radians(180.0f),glm::vec3(0.0f,1.0f,0.0f));
+    model = glm::scale(model, glm::vec3(75.0f));
+    staticBatch.Add(wallVertices, 6, model, wallTexture.Id());
+    //right wall
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(75.0f, 15.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(-90.0f),glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(75.0f));
+    staticBatch.Add(wallVertices, 6, model, wallTexture.Id());
+    //left wall
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(-75.0f, 15.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(90.0f),glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(75.0f));
+    staticBatch.Add(wallVertices, 6, model, wallTexture.Id());
+    // notes
+    model = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
+    model = glm::translate(model, glm::vec3(glm::vec3((glm::mod((float)14,10.0f) * 15.0f - 75.0f + 7.5f + cos(glm::radians(10.0f*14)*14)*3.75f),
+                                                      0.0f,
+                                                      (glm::floor(14/10.0f)) * 15.0f - 75.0f + 7.5f + sin(glm::radians(10.0f*14)*14)*3.75f)) + glm::vec3(-0.07f, 1.0f, 0.65f));
+    staticBatch.Add(transparentVertices, 6, model, noteTextures, 0, noteScales[0]);
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3((glm::mod((float)72,10.0f) * 15.0f - 75.0f + 7.5f + cos(glm::radians(10.0f*72)*72)*3.75f),
+                                            0.0f,
+                                            (glm::floor(72/10.0f)) * 15.0f - 75.0f + 7.5f + sin(glm::radians(10.0f*72)*72)*3.75f)+ glm::vec3(0.03f, 1.0f, 0.65f));
+    staticBatch.Add(transparentVertices, 6, model, noteTextures, 1, noteScales[1]);
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3((glm::mod((float)87,10.0f) * 15.0f - 75.0f + 7.5f + cos(glm::radians(10.0f*87)*87)*3.75f),
+                                            0.0f,
+                                            (glm::floor(87/10.0f)) * 15.0f - 75.0f + 7.5f + sin(glm::radians(10.0f*87)*87)*3.75f) + glm::vec3 (-0.05f, 1.0f, 0.65f));
+    staticBatch.Add(transparentVertices, 6, model, noteTextures, 2, noteScales[2]);
+    staticBatch.Build();
+
+    // hierarchy over the world space boxes of the trees, groups of trees outside of the view are skipped at once
+    std::vector<AABB> treeBounds(amount);
+    for (int i = 0; i < amount; ++i)
+        treeBounds[i] = treeModel.aabb.transformed(treeModelMatrices[i]);
+    InstanceBVH treeBVH;
+    treeBVH.Build(treeBounds);
+    std::vector<unsigned int> visibleTrees;
+    std::vector<glm::mat4> visibleTreeMatrices;
+    std::vector<glm::mat4> farTreeMatrices;
+    visibleTreeMatrices.reserve(amount);
+    farTreeMatrices.reserve(amount);
+
+    // far trees are replaced by views of the model baked from many directions
+    Shader impostorBakeShader("resources/shaders/impostor_bake.vs", "resources/shaders/impostor_bake.fs");
+    Shader impostorShader("resources/shaders/impostor.vs", "resources/shaders/impostor.fs");
+    Impostor treeImpostor;
+    treeImpostor.Bake(treeModel, impostorBakeShader);
+
     // directional light
     DirLight dirLight;
     dirLight.ambient = glm::vec3(0.01f);
@@ -261,6 +281,27 @@ int main()
     spotLight.cutOff = glm::cos(glm::radians(12.5f));
     spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
 
+    // per-frame state shared by all programs
+    FrameUniforms frameUniforms;
+    frameUniforms.Create();
+    frameUniforms.Attach(modelShader);
+    frameUniforms.Attach(impostorShader);
+    frameUniforms.Attach(staticShader);
+    FrameData frameData;
+
+    // per-frame data (camera, lights, instance matrices) is written into a ring of buffer regions
+    StreamBuffer frameStream;
+    frameStream.Create((GLADloadproc)glfwGetProcAddress, 1 << 20);
+    treeModel.instanceStream = &frameStream;
+    treeImpostor.instanceStream = &frameStream;
+
+    // the material does not change between frames
+    modelShader.use();
+    modelShader.setFloat("material.shininess", 32.0f);
+    staticShader.use();
+    staticShader.setFloat("material.shininess", 32.0f);
+    RenderQueue renderQueue;
+
     // render loop
     // -----------
 
@@ -284,9 +325,6 @@ int main()
         glm::mat4 view = camera.GetViewMatrix();
 
 
-        // enabling shader before setting uniforms
-        modelShader.use();
-
         // calculating day-night cycle
         float time = currentFrame;
         float sin_time = sin(time/10);
@@ -299,120 +337,56 @@ int main()
         else {
             dirLight.direction = glm::vec3(0, 0, 0);
         }
-        modelShader.setVec3("dirLight.direction", dirLight.direction);
-        modelShader.setVec3("dirLight.ambient", dirLight.ambient);
-        modelShader.setVec3("dirLight.diffuse", dirLight.diffuse);
-        modelShader.setVec3("dirLight.specular", dirLight.specular);
-
         spotLight.direction = camera.Front;
         spotLight.position = camera.Position;
-        modelShader.setBool("spotLightOn", flashlightOn);
-        modelShader.setVec3("spotLight.position", spotLight.position);
-        modelShader.setVec3("spotLight.direction", spotLight.direction);
-        modelShader.setVec3("spotLight.ambient", spotLight.ambient);
-        modelShader.setVec3("spotLight.diffuse", spotLight.diffuse);
-        modelShader.setVec3("spotLight.specular", spotLight.specular);
-        modelShader.setFloat("spotLight.constant", spotLight.constant);
-        modelShader.setFloat("spotLight.linear", spotLight.linear);
-        modelShader.setFloat("spotLight.quadratic", spotLight.quadratic);
-        modelShader.setFloat("spotLight.cutOff", spotLight.cutOff);
-        modelShader.setFloat("spotLight.outerCutOff", spotLight.outerCutOff);
-
-        modelShader.setVec3("viewPosition", camera.Position);
-        modelShader.setFloat("material.shininess", 32.0f);
-        // view/projection transformations
-
-        modelShader.setMat4("projection", projection);
-        modelShader.setMat4("view", view);
-
-        // rendering the floor
-        glActiveTexture(GL_TEXTURE0);
-        glBindVertexArray(planeVAO);
-        glUniform1i(glGetUniformLocation(modelShader.ID, "material.texture_diffuse1"), 0);
-        glBindTexture(GL_TEXTURE_2D, floorTexture);
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::scale(model, glm::vec3(15.0f));
-        modelShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        //rendering the sky
-        glBindVertexArray(skyVAO);
-        glUniform1i(glGetUniformLocation(modelShader.ID, "material.texture_diffuse1"), 0);
-        glBindTexture(GL_TEXTURE_2D, skyTexture);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 35.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(15.0f));
-        modelShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        //rendering the walls
-        glBindVertexArray(wallVAO);
-        glUniform1i(glGetUniformLocation(modelShader.ID, "material.texture_diffuse1"), 0);
-        glBindTexture(GL_TEXTURE_2D, wallTexture);
-        //front wall
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 15.0f, -75.0f));
-        model = glm::scale(model, glm::vec3(75.0f));
-        modelShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        //back wall
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 15.0f, 75.0f));
-        model = glm::rotate(model, glm::radians(180.0f),glm::vec3(0.0f,1.0f,0.0f));
-        model = glm::scale(model, glm::vec3(75.0f));
-        modelShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        //right wall
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(75.0f, 15.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(-90.0f),glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(75.0f));
-        modelShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        //left wall
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(-75.0f, 15.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(90.0f),glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(75.0f));
-        modelShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        // rendering notes
-        glBindVertexArray(transparentVAO);
-        glUniform1i(glGetUniformLocation(modelShader.ID, "material.texture_diffuse1"), 0);
-        glBindTexture(GL_TEXTURE_2D, noteTexture1);
-
-        model = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-        model = glm::translate(model, glm::vec3(glm::vec3((glm::mod((float)14,10.0f) * 15.0f - 75.0f + 7.5f + cos(glm::radians(10.0f*14)*14)*3.75f),
-                                                          0.0f,
-                                                          (glm::floor(14/10.0f)) * 15.0f - 75.0f + 7.5f + sin(glm::radians(10.0f*14)*14)*3.75f)) + glm::vec3(-0.07f, 1.0f, 0.65f));
-        modelShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        glBindTexture(GL_TEXTURE_2D, noteTexture2);
-        model = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-        model = glm::translate(model, glm::vec3((glm::mod((float)72,10.0f) * 15.0f - 75.0f + 7.5f + cos(glm::radians(10.0f*72)*72)*3.75f),
-                                                0.0f,
-                                                (glm::floor(72/10.0f)) * 15.0f - 75.0f + 7.5f + sin(glm::radians(10.0f*72)*72)*3.75f)+ glm::vec3(0.03f, 1.0f, 0.65f));
-        modelShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        glBindTexture(GL_TEXTURE_2D, noteTexture3);
-        model = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-        model = glm::translate(model, glm::vec3((glm::mod((float)87,10.0f) * 15.0f - 75.0f + 7.5f + cos(glm::radians(10.0f*87)*87)*3.75f),
-                                                0.0f,
-                                                (glm::floor(87/10.0f)) * 15.0f - 75.0f + 7.5f + sin(glm::radians(10.0f*87)*87)*3.75f) + glm::vec3 (-0.05f, 1.0f, 0.65f));
-        modelShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        // rendering the trees
-        for(int i = 0; i < amount; ++i) {
-            modelShader.setMat4("model", treeModelMatrices[i]);
-            treeModel.Draw(modelShader);
+
+        frameStream.BeginFrame();
+
+        // camera and lights go to every program at once through the uniform buffer
+        frameData.projection = projection;
+        frameData.view = view;
+        frameData.viewPosition = camera.Position;
+        frameData.time = time;
+        frameData.dirLight = dirLight;
+        frameData.spotLight = spotLight;
+        frameData.spotLightOn = flashlightOn;
+        frameUniforms.Update(frameData, &frameStream);
+
+        // all draws of the frame are collected first and issued sorted by program, vertex array and texture
+        renderQueue.Begin(camera.Position, 250.0f);
+        // the static scenery is one draw per texture
+        staticBatch.Submit(renderQueue, staticShader);
+
+        // culling the trees against the view frustum, only the visible ones are uploaded
+        // and the far ones are handed over to the impostors
+        treeBVH.Cull(Frustum(projection * view), visibleTrees);
+        visibleTreeMatrices.clear();
+        farTreeMatrices.clear();
+        for (unsigned int i : visibleTrees) {
+            glm::vec3 treeCenter = glm::vec3(treeModelMatrices[i] * glm::vec4(treeModel.boundingSphere.center, 1.0f));
+            if (glm::length(treeCenter - camera.Position) < impostorDistance)
+                visibleTreeMatrices.push_back(treeModelMatrices[i]);
+            else
+                farTreeMatrices.push_back(treeModelMatrices[i]);
         }
+        treeModel.SetInstanceMatrices(visibleTreeMatrices.data(), visibleTreeMatrices.size(), camera.Position);
+        treeImpostor.SetInstanceMatrices(farTreeMatrices.data(), farTreeMatrices.size());
+        frameStream.Commit();
+
+        // rendering the trees, every mesh of the model is drawn once per level of detail
+        treeModel.SubmitInstanced(renderQueue, modelShader);
+        renderQueue.Flush();
+
+        // rendering the far trees as impostors
+        impostorShader.use();
+        treeImpostor.Draw(impostorShader);
+        frameStream.EndFrame();
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
+        // textures queued after startup come in as their decodes finish
+        textureLoader.Update();
+
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
@@ -420,14 +394,14 @@ int main()
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
-    glDeleteVertexArrays(1, &planeVAO);
-    glDeleteBuffers(1, &planeVBO);
-    glDeleteVertexArrays(1, &skyVAO);
-    glDeleteBuffers(1, &skyVBO);
-    glDeleteVertexArrays(1, &wallVAO);
-    glDeleteBuffers(1, &wallVBO);
-    glDeleteVertexArrays(1, &transparentVAO);
-    glDeleteBuffers(1, &transparentVBO);
+    staticBatch.Delete();
+    treeModel.Delete();
+    treeImpostor.Delete();
+    frameUniforms.Delete();
+    frameStream.Delete();
+    textureUploader.Delete();
+    TextureCache::Clear();
+    delete[] treeModelMatrices;
     glfwTerminate();
     return 0;
 }
@@ -502,45 +476,3 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         }
     }
 }
-
-unsigned int loadTexture(char const * path, bool gamma)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum dataFormat;
-        GLenum internalFormat;
-        if (nrComponents == 1)
-            internalFormat = dataFormat = GL_RED;
-        else if (nrComponents == 3) {
-            internalFormat = gamma ? GL_SRGB : GL_RGB;
-            dataFormat = GL_RGB;
-        }
-        else if (nrComponents == 4){
-            internalFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
-            dataFormat = GL_RGBA;
-        }
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, dataFormat == GL_RGBA ? GL_CLAMP_TO_EDGE :GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, dataFormat == GL_RGBA ? GL_CLAMP_TO_EDGE :GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
-}
\ No newline at end of file
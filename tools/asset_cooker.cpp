@@ -0,0 +1,155 @@
+// asset_cooker: walks a resource directory and writes everything the game loads from it into one asset pack.
+//   textures (png, jpg, jpeg, tga, bmp)  all mip levels, BC1/BC3 compressed where possible (CookedTexture)
+//   models (obj, fbx, dae, gltf, glb)    imported, simplified and stored as a mesh cache (MeshCache)
+//   shaders (vs, fs, gs, glsl)           as they are
+// Run it from the directory the game runs in, so the pack keys match the paths the game asks for:
+//   asset_cooker [resource directory = resources] [pack = resources.pack]
+#include <stb_image.h>
+
+#include <learnopengl/asset_pack.h>
+#include <learnopengl/cooked_texture.h>
+#include <learnopengl/mapped_file.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_import.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static void collectFiles(const std::string &directory, std::vector<std::string> &files)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        return;
+    while (dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        // skips "." and ".." as well as hidden tool folders like .mayaSwatches
+        if (name.empty() || name[0] == '.')
+            continue;
+        std::string path = directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            continue;
+        if (S_ISDIR(info.st_mode))
+            collectFiles(path, files);
+        else if (S_ISREG(info.st_mode))
+            files.push_back(path);
+    }
+    closedir(dir);
+}
+
+static std::string extensionOf(const std::string &path)
+{
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || path.find('/', dot) != std::string::npos)
+        return "";
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension;
+}
+
+static bool isOneOf(const std::string &extension, std::initializer_list<const char*> extensions)
+{
+    for (const char *candidate: extensions)
+        if (extension == candidate)
+            return true;
+    return false;
+}
+
+static bool cookTexture(const std::string &path, const MappedFile &source, AssetPack::Writer &pack)
+{
+    int width, height, nrComponents;
+    if (!stbi_info_from_memory(source.data(), source.size(), &width, &height, &nrComponents))
+        return false;
+    // grey with alpha has no GL format of its own, it becomes RGBA
+    int components = nrComponents == 2 ? 4 : nrComponents;
+    unsigned char *pixels = stbi_load_from_memory(source.data(), source.size(), &width, &height, &nrComponents, components);
+    if (!pixels)
+        return false;
+    // every texture of the scene is color loaded as sRGB, so the mips are filtered in linear light
+    std::vector<unsigned char> cooked = CookedTexture::Cook(pixels, width, height, components, true, true);
+    stbi_image_free(pixels);
+    pack.Add(path, AssetPack::TEXTURE, source.hash(), cooked.data(), cooked.size());
+    return true;
+}
+
+static bool cookModel(const std::string &path, AssetPack::Writer &pack)
+{
+    std::vector<ImportedMesh> meshes;
+    if (!MeshImporter::Import(path, meshes))
+        return false;
+    uint64_t sourceHash = MeshCache::SourceHash(path);
+    std::vector<unsigned char> cooked = MeshCache::Serialize(sourceHash, meshes);
+    if (cooked.empty())
+        return false;
+    pack.Add(path, AssetPack::MESH, sourceHash, cooked.data(), cooked.size());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    std::string resourceDirectory = argc > 1 ? argv[1] : "resources";
+    std::string packPath = argc > 2 ? argv[2] : "resources.pack";
+    while (resourceDirectory.size() > 1 && resourceDirectory.back() == '/')
+        resourceDirectory.pop_back();
+
+    std::vector<std::string> files;
+    collectFiles(resourceDirectory, files);
+    // the same tree always gives the same pack
+    std::sort(files.begin(), files.end());
+
+    AssetPack::Writer pack;
+    unsigned int textures = 0, models = 0, shaders = 0, failed = 0;
+    for (const std::string &path: files)
+    {
+        std::string extension = extensionOf(path);
+        bool texture = isOneOf(extension, {"png", "jpg", "jpeg", "tga", "bmp"});
+        bool model = isOneOf(extension, {"obj", "fbx", "dae", "gltf", "glb"});
+        bool shader = isOneOf(extension, {"vs", "fs", "gs", "glsl"});
+        // material libraries and the like are only read while a model is imported
+        if (!texture && !model && !shader)
+            continue;
+
+        MappedFile source;
+        if (!source.Open(path))
+        {
+            std::cout << "could not read " << path << std::endl;
+            failed++;
+            continue;
+        }
+        bool cooked;
+        if (texture)
+            cooked = cookTexture(path, source, pack);
+        else if (model)
+            cooked = cookModel(path, pack);
+        else
+        {
+            pack.Add(path, AssetPack::RAW, source.hash(), source.data(), source.size());
+            cooked = true;
+        }
+        if (!cooked)
+        {
+            std::cout << "could not cook " << path << std::endl;
+            failed++;
+            continue;
+        }
+        textures += texture;
+        models += model;
+        shaders += shader;
+    }
+
+    if (!pack.Save(packPath))
+        return 1;
+    std::cout << packPath << ": " << textures << " textures, " << models << " models, " << shaders << " shaders";
+    if (failed)
+        std::cout << ", " << failed << " failed";
+    std::cout << std::endl;
+    return failed ? 1 : 0;
+}